@@ -0,0 +1,160 @@
+#pragma once
+#include "Prerequisites.h"
+
+/**
+ * @class AhoCorasick
+ * @brief Autmata para buscar muchos patrones a la vez en una sola pasada.
+ *
+ * La tabla de transiciones es plana (estado x clase de byte) y ya incluye
+ * los enlaces de fallo, as que avanzar un byte es una sola consulta. Los
+ * bytes que no aparecen en ningn patrn comparten la clase 0, con lo que
+ * la tabla ocupa pocas lneas de cach aunque haya muchos patrones.
+ */
+class
+AhoCorasick {
+public:
+  AhoCorasick() = default;
+
+  /**
+   * @param patterns Patrones a buscar (no vacos).
+   * @param weights  Peso de cada patrn para score(); vaco = su longitud.
+   * @throws std::invalid_argument Si hay un patrn vaco o los pesos no
+   *         coinciden con los patrones.
+   */
+  explicit AhoCorasick(const std::vector<std::string>& patterns,
+    std::vector<double> weights = {}) {
+    if (weights.empty()) {
+      for (const auto& p : patterns) weights.push_back(double(p.size()));
+    }
+    if (weights.size() != patterns.size()) {
+      throw std::invalid_argument("Se necesita un peso por patrn.");
+    }
+    m_weights = std::move(weights);
+    for (const auto& p : patterns) {
+      if (p.empty()) throw std::invalid_argument("Patrn vaco.");
+      m_lengths.push_back(p.size());
+    }
+    build(patterns);
+  }
+
+  size_t
+  size() const {
+    return m_lengths.size();
+  }
+
+  /// Llama a fn(patrn, fin) por cada aparicin, incluidas las solapadas;
+  /// el patrn ocupa [fin - longitud, fin).
+  template <typename Fn>
+  void
+  forEachMatch(const char* data, size_t n, Fn&& fn) const {
+    if (m_next.empty()) return;
+    uint32_t state = 0;
+    for (size_t i = 0; i < n; ++i) {
+      state = m_next[state * m_classes + m_class[static_cast<unsigned char>(data[i])]];
+      for (uint32_t o = m_outStart[state]; o < m_outStart[state + 1]; ++o) {
+        fn(m_out[o], i + 1);
+      }
+    }
+  }
+
+  /**
+   * @brief Suma de pesos de las apariciones no solapadas de cada patrn.
+   *
+   * Da lo mismo que buscar cada patrn por separado con std::string::find
+   * y continuar tras cada aparicin: las apariciones de un mismo patrn no
+   * se solapan entre s, las de patrones distintos s pueden.
+   */
+  double
+  score(const char* data, size_t n) const {
+    // Fin de la ltima aparicin contada de cada patrn (scratch por hilo).
+    thread_local std::vector<size_t> lastEnd;
+    lastEnd.assign(m_lengths.size(), 0);
+    double total = 0.0;
+    forEachMatch(data, n, [&](uint32_t p, size_t end) {
+      if (end - m_lengths[p] >= lastEnd[p]) {
+        lastEnd[p] = end;
+        total += m_weights[p];
+      }
+      });
+    return total;
+  }
+
+private:
+  uint32_t m_classes = 0;                 ///< Clases de byte (0 = ninguno de los patrones).
+  std::array<uint8_t, 256> m_class{};     ///< Byte -> clase.
+  std::vector<uint32_t> m_next;           ///< Transiciones: estado * m_classes + clase.
+  std::vector<uint32_t> m_outStart;       ///< Salidas del estado s: m_out[m_outStart[s], m_outStart[s + 1]).
+  std::vector<uint32_t> m_out;            ///< Patrones que terminan en cada estado.
+  std::vector<size_t> m_lengths;
+  std::vector<double> m_weights;
+
+  void
+  build(const std::vector<std::string>& patterns) {
+    // Clases de byte
+    m_class.fill(0);
+    m_classes = 1;
+    for (const auto& p : patterns) {
+      for (unsigned char c : p) {
+        if (m_class[c] == 0) {
+          if (m_classes == 256) throw std::invalid_argument("Demasiados bytes distintos en los patrones.");
+          m_class[c] = static_cast<uint8_t>(m_classes++);
+        }
+      }
+    }
+
+    // Trie; kNone marca transiciones an sin definir
+    const uint32_t kNone = std::numeric_limits<uint32_t>::max();
+    m_next.assign(m_classes, kNone);
+    std::vector<std::vector<uint32_t>> outputs(1);
+    for (uint32_t id = 0; id < patterns.size(); ++id) {
+      uint32_t state = 0;
+      for (unsigned char c : patterns[id]) {
+        uint32_t& next = m_next[state * m_classes + m_class[c]];
+        if (next == kNone) {
+          next = static_cast<uint32_t>(outputs.size());
+          outputs.emplace_back();
+          m_next.resize(m_next.size() + m_classes, kNone);
+        }
+        state = m_next[state * m_classes + m_class[c]];
+      }
+      outputs[state].push_back(id);
+    }
+
+    // Enlaces de fallo por anchura, incorporados a la tabla
+    const size_t states = outputs.size();
+    std::vector<uint32_t> fail(states, 0), queue;
+    queue.reserve(states);
+    for (uint32_t c = 0; c < m_classes; ++c) {
+      uint32_t& next = m_next[c];
+      if (next == kNone) {
+        next = 0;
+      }
+      else {
+        queue.push_back(next);
+      }
+    }
+    for (size_t head = 0; head < queue.size(); ++head) {
+      uint32_t s = queue[head];
+      const auto& inherited = outputs[fail[s]];
+      outputs[s].insert(outputs[s].end(), inherited.begin(), inherited.end());
+      for (uint32_t c = 0; c < m_classes; ++c) {
+        uint32_t& next = m_next[s * m_classes + c];
+        if (next == kNone) {
+          next = m_next[fail[s] * m_classes + c];
+        }
+        else {
+          fail[next] = m_next[fail[s] * m_classes + c];
+          queue.push_back(next);
+        }
+      }
+    }
+
+    m_outStart.assign(states + 1, 0);
+    m_out.clear();
+    for (size_t s = 0; s < states; ++s) {
+      m_outStart[s] = static_cast<uint32_t>(m_out.size());
+      m_out.insert(m_out.end(), outputs[s].begin(), outputs[s].end());
+    }
+    m_outStart[states] = static_cast<uint32_t>(m_out.size());
+  }
+};
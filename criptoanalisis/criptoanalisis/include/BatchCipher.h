@@ -0,0 +1,166 @@
+#pragma once
+#include "Prerequisites.h"
+#include "CesarEncryption.h"
+#include "ThreadPool.h"
+#include "Vigenere.h"
+
+/**
+ * @struct MessageBatch
+ * @brief Muchos mensajes pequeos en un solo bloque de memoria.
+ *
+ * El mensaje i ocupa arena[offsets[i], offsets[i + 1]). offsets siempre
+ * empieza con 0, nunca decrece, termina en arena.size() y tiene size() + 1
+ * elementos; BatchCipher rechaza los lotes que no lo cumplen.
+ */
+struct MessageBatch {
+  std::string arena;
+  std::vector<size_t> offsets{ 0 };
+
+  void
+  add(const std::string& message) {
+    arena += message;
+    offsets.push_back(arena.size());
+  }
+
+  void
+  clear() {
+    arena.clear();
+    offsets.assign(1, 0);
+  }
+
+  size_t
+  size() const {
+    return offsets.size() - 1;
+  }
+
+  size_t
+  length(size_t i) const {
+    return offsets[i + 1] - offsets[i];
+  }
+
+  std::string
+  message(size_t i) const {
+    return arena.substr(offsets[i], length(i));
+  }
+};
+
+/**
+ * @class BatchCipher
+ * @brief Cifra, descifra y rompe lotes de mensajes en paralelo.
+ *
+ * Todas las operaciones conservan la longitud de cada mensaje, as la
+ * salida usa los mismos offsets que la entrada: se reserva una sola arena
+ * de salida (reutilizable entre llamadas) y cada hilo escribe directamente
+ * en su tramo, sin reservar memoria por mensaje.
+ */
+class
+BatchCipher {
+public:
+  explicit BatchCipher(ThreadPool& pool = ThreadPool::shared()) : m_pool(pool) {}
+
+  // --- Csar ---
+  void
+  cesarEncrypt(const MessageBatch& in, int desplazamiento, MessageBatch& out) const {
+    prepareOutput(in, out);
+    // Un solo desplazamiento: la arena completa es un nico texto.
+    const size_t n = in.arena.size();
+    m_pool.parallelFor(n, kByteGrain, [&](unsigned, size_t begin, size_t end) {
+      CesarEncryption::encodeInto(in.arena.data() + begin, end - begin,
+        &out.arena[0] + begin, desplazamiento);
+      });
+  }
+
+  void
+  cesarDecrypt(const MessageBatch& in, int desplazamiento, MessageBatch& out) const {
+    cesarEncrypt(in, 26 - (desplazamiento % 26), out);
+  }
+
+  /// Un desplazamiento por mensaje (desplazamientos.size() == in.size()).
+  void
+  cesarEncrypt(const MessageBatch& in, const std::vector<int>& desplazamientos,
+    MessageBatch& out) const {
+    checkCount(in, desplazamientos.size());
+    prepareOutput(in, out);
+    forEachMessage(in, [&](size_t i, const char* src, size_t len, char* dst) {
+      CesarEncryption::encodeInto(src, len, dst, desplazamientos[i]);
+      }, out);
+  }
+
+  void
+  cesarDecrypt(const MessageBatch& in, const std::vector<int>& desplazamientos,
+    MessageBatch& out) const {
+    checkCount(in, desplazamientos.size());
+    prepareOutput(in, out);
+    forEachMessage(in, [&](size_t i, const char* src, size_t len, char* dst) {
+      CesarEncryption::encodeInto(src, len, dst, 26 - (desplazamientos[i] % 26));
+      }, out);
+  }
+
+  /// Estima la clave de cada mensaje (CesarEncryption::crackKey) y deja en
+  /// 'out' el mensaje descifrado con ella.
+  std::vector<CesarEncryption::CrackResult>
+  cesarCrack(const MessageBatch& in, MessageBatch& out) const {
+    prepareOutput(in, out);
+    std::vector<CesarEncryption::CrackResult> results(in.size());
+    forEachMessage(in, [&](size_t i, const char* src, size_t len, char* dst) {
+      results[i] = CesarEncryption::crackKey(src, len);
+      CesarEncryption::encodeInto(src, len, dst, 26 - results[i].clave);
+      }, out);
+    return results;
+  }
+
+  // --- Vigenre (el flujo de clave empieza de nuevo en cada mensaje) ---
+  void
+  vigenereEncrypt(const MessageBatch& in, const Vigenere& cipher, MessageBatch& out) const {
+    prepareOutput(in, out);
+    forEachMessage(in, [&](size_t, const char* src, size_t len, char* dst) {
+      cipher.encodeInto(src, len, dst);
+      }, out);
+  }
+
+  void
+  vigenereDecrypt(const MessageBatch& in, const Vigenere& cipher, MessageBatch& out) const {
+    prepareOutput(in, out);
+    forEachMessage(in, [&](size_t, const char* src, size_t len, char* dst) {
+      cipher.decodeInto(src, len, dst);
+      }, out);
+  }
+
+private:
+  static constexpr size_t kMessageGrain = 1024;     ///< Mensajes por bloque de trabajo.
+  static constexpr size_t kByteGrain = 1 << 16;     ///< Bytes por bloque de trabajo.
+
+  ThreadPool& m_pool;
+
+  static void
+  prepareOutput(const MessageBatch& in, MessageBatch& out) {
+    // Un offset que decrece hara que length(i) diera la vuelta y los hilos
+    // leeran y escribiran fuera de las arenas.
+    if (in.offsets.empty() || in.offsets.front() != 0 || in.offsets.back() != in.arena.size()
+      || !std::is_sorted(in.offsets.begin(), in.offsets.end())) {
+      throw std::invalid_argument("Offsets del lote invlidos.");
+    }
+    out.arena.resize(in.arena.size());
+    out.offsets = in.offsets;
+  }
+
+  static void
+  checkCount(const MessageBatch& in, size_t count) {
+    if (count != in.size()) {
+      throw std::invalid_argument("Se necesita un desplazamiento por mensaje.");
+    }
+  }
+
+  template <typename Fn>
+  void
+  forEachMessage(const MessageBatch& in, Fn&& fn, MessageBatch& out) const {
+    const char* src = in.arena.data();
+    char* dst = &out.arena[0];
+    const size_t* off = in.offsets.data();
+    m_pool.parallelFor(in.size(), kMessageGrain, [&](unsigned, size_t begin, size_t end) {
+      for (size_t i = begin; i < end; ++i) {
+        fn(i, src + off[i], off[i + 1] - off[i], dst + off[i]);
+      }
+      });
+  }
+};
@@ -0,0 +1,348 @@
+#pragma once
+#include "Prerequisites.h"
+#include "TopK.h"
+
+/**
+ * @class CandidateArchive
+ * @brief Destino comn de los ataques de fuerza bruta: conserva los N
+ *        mejores candidatos y los guarda en un nico archivo indexado.
+ *
+ * Los ataques ofrecen (puntaje, clave) con offer(); solo las claves quedan
+ * en memoria. Al final, commit() regenera el texto de los ganadores y los
+ * aade al archivo. Con keyOnly se guarda solo la clave y el texto se
+ * regenera al leer.
+ *
+ * Formato (enteros little-endian):
+ *   cabecera : "CRIPTARC" | versin u32 | huella de la entrada u64
+ *   datos    : clave y texto de cada candidato, uno tras otro
+ *   ndice   : por candidato: keyOffset u64 | keyLen u32 | flags u32 |
+ *              score f64 | offset u64 | length u64
+ *   pie      : indexOffset u64 | count u64 | "CRIPTIDX"
+ * Cada commit une los candidatos nuevos con los guardados, conserva los N
+ * mejores sin claves repetidas y reescribe el archivo completo; el lector
+ * usa el pie del final. Si la huella no coincide con la del archivo
+ * atacado (o el archivo es de otra versin o est daado), commit() lo
+ * descarta y empieza uno nuevo, para no mezclar candidatos de entradas
+ * distintas.
+ */
+class
+CandidateArchive {
+public:
+  struct Entry {
+    std::string key;         ///< Clave en bytes crudos.
+    uint64_t keyOffset = 0;  ///< Posicin de la clave en el archivo.
+    double score = 0.0;      ///< Mayor es mejor.
+    uint64_t offset = 0;     ///< Posicin del texto en el archivo (si stored).
+    uint64_t length = 0;     ///< Longitud del texto guardado (si stored).
+    bool stored = false;     ///< false: solo se guard la clave.
+  };
+
+  /// Devuelve el texto descifrado correspondiente a una clave.
+  using Regenerator = std::function<std::string(const std::string& key)>;
+
+  explicit CandidateArchive(size_t capacity = 16) : m_best(capacity) {}
+
+  /// Ofrece un candidato; seguro entre hilos. Devuelve true si entra al top.
+  bool
+  offer(double score, const std::string& key) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_best.push(score, key);
+  }
+
+  /// Une un ranking parcial (por ejemplo, el de un hilo).
+  void
+  merge(const TopK<std::string>& other) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_best.merge(other);
+  }
+
+  /// Candidatos actuales, de mejor a peor.
+  std::vector<TopK<std::string>::Entry>
+  ranking() const {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    return m_best.sorted();
+  }
+
+  /**
+   * @brief Une los candidatos actuales con los del archivo y lo reescribe
+   *        con los N mejores, el mejor primero.
+   *
+   * Una clave ya guardada no se repite (se queda con su mejor puntaje) y su
+   * texto se copia del archivo anterior sin regenerarlo. El archivo nuevo se
+   * escribe en un temporal y reemplaza al anterior al terminar: si algo
+   * falla a medias, el archivo previo sigue intacto.
+   *
+   * @param path       Archivo de destino; se crea si no existe.
+   * @param source     Huella de la entrada atacada (ver fingerprint()).
+   * @param regenerate Produce el texto de cada clave (no se usa con keyOnly).
+   * @param keyOnly    Guarda solo clave y puntaje de los candidatos nuevos.
+   * @return Nmero de candidatos que quedan en el archivo.
+   */
+  size_t
+  commit(const std::string& path, uint64_t source, const Regenerator& regenerate,
+    bool keyOnly = false) {
+    struct Pending {
+      Entry entry;
+      bool inFile;  ///< Ya estaba en el archivo anterior.
+    };
+
+    // Candidatos previos de esta misma entrada; un archivo de otra entrada,
+    // de otra versin o con el ndice daado se descarta y empieza de nuevo.
+    std::vector<Pending> kept;
+    if (sourceOf(path) == source) {
+      try {
+        for (Entry& e : index(path)) keep(kept, Pending{ std::move(e), true });
+      }
+      catch (const std::runtime_error&) {
+        kept.clear();
+      }
+    }
+    for (const auto& cand : ranking()) {
+      Entry e;
+      e.key = cand.value;
+      e.score = cand.score;
+      keep(kept, Pending{ std::move(e), false });
+    }
+    std::stable_sort(kept.begin(), kept.end(), [](const Pending& a, const Pending& b) {
+      return a.entry.score > b.entry.score;
+      });
+    if (kept.size() > m_best.capacity()) kept.resize(m_best.capacity());
+
+    const std::string tmpPath = tempPathFor(path);
+    try {
+      std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+      if (!out) throw std::runtime_error("No se pudo escribir: " + tmpPath);
+      out.write(kMagic, 8);
+      putU32(out, kVersion);
+      putU64(out, source);
+
+      std::vector<Entry> entries;
+      for (const Pending& p : kept) {
+        Entry e = p.entry;
+        e.keyOffset = static_cast<uint64_t>(out.tellp());
+        out.write(e.key.data(), e.key.size());
+        const bool copy = p.inFile && e.stored;
+        if (copy || !keyOnly) {
+          std::string plain = copy ? read(path, p.entry) : regenerate(e.key);
+          e.offset = static_cast<uint64_t>(out.tellp());
+          e.length = plain.size();
+          e.stored = true;
+          out.write(plain.data(), plain.size());
+        }
+        else {
+          e.offset = e.length = 0;
+          e.stored = false;
+        }
+        entries.push_back(std::move(e));
+      }
+
+      uint64_t indexOffset = static_cast<uint64_t>(out.tellp());
+      for (const Entry& e : entries) {
+        putU64(out, e.keyOffset);
+        putU32(out, static_cast<uint32_t>(e.key.size()));
+        putU32(out, e.stored ? kFlagStored : 0);
+        putF64(out, e.score);
+        putU64(out, e.offset);
+        putU64(out, e.length);
+      }
+      putU64(out, indexOffset);
+      putU64(out, entries.size());
+      out.write(kIndexMagic, 8);
+      out.close();
+      if (!out) throw std::runtime_error("Error de escritura en: " + tmpPath);
+      fs::rename(tmpPath, path);
+    }
+    catch (...) {
+      std::error_code ec;
+      fs::remove(tmpPath, ec);
+      throw;
+    }
+    return kept.size();
+  }
+
+  /// Lee el ndice ms reciente del archivo; uno vaco no tiene candidatos.
+  static std::vector<Entry>
+  index(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) throw std::runtime_error("No se pudo abrir: " + path);
+    const uint64_t size = static_cast<uint64_t>(in.tellg());
+    if (size == 0) return {};
+    if (size < kHeaderSize + kFooterSize) {
+      throw std::runtime_error("Archivo de candidatos invlido: " + path);
+    }
+
+    char magic[8];
+    in.seekg(0);
+    in.read(magic, 8);
+    if (std::memcmp(magic, kMagic, 8) != 0 || getU32(in) != kVersion) {
+      throw std::runtime_error("Archivo de candidatos invlido: " + path);
+    }
+
+    in.seekg(size - kFooterSize);
+    uint64_t indexOffset = getU64(in);
+    uint64_t count = getU64(in);
+    in.read(magic, 8);
+    if (!in || std::memcmp(magic, kIndexMagic, 8) != 0
+      || indexOffset + count * kRecordSize + kFooterSize != size) {
+      throw std::runtime_error("ndice de candidatos daado: " + path);
+    }
+
+    std::vector<Entry> entries(static_cast<size_t>(count));
+    std::vector<uint32_t> keyLens(entries.size());
+    in.seekg(indexOffset);
+    for (size_t i = 0; i < entries.size(); ++i) {
+      entries[i].keyOffset = getU64(in);
+      keyLens[i] = getU32(in);
+      entries[i].stored = (getU32(in) & kFlagStored) != 0;
+      entries[i].score = getF64(in);
+      entries[i].offset = getU64(in);
+      entries[i].length = getU64(in);
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+      entries[i].key.resize(keyLens[i]);
+      in.seekg(entries[i].keyOffset);
+      in.read(&entries[i].key[0], keyLens[i]);
+    }
+    if (!in) throw std::runtime_error("ndice de candidatos daado: " + path);
+    return entries;
+  }
+
+  /// Texto de un candidato: el guardado o, si solo hay clave, el regenerado.
+  static std::string
+  read(const std::string& path, const Entry& entry, const Regenerator& regenerate = nullptr) {
+    if (!entry.stored) {
+      if (!regenerate) throw std::runtime_error("El candidato solo guarda la clave.");
+      return regenerate(entry.key);
+    }
+    std::ifstream in(path, std::ios::binary);
+    if (!in) throw std::runtime_error("No se pudo abrir: " + path);
+    std::string plain(static_cast<size_t>(entry.length), '\0');
+    in.seekg(entry.offset);
+    in.read(&plain[0], plain.size());
+    if (!in) throw std::runtime_error("No se pudo leer el candidato de: " + path);
+    return plain;
+  }
+
+  /// Huella FNV-1a de 64 bits de la entrada atacada.
+  static uint64_t
+  fingerprint(const void* data, size_t n) {
+    const auto* p = static_cast<const unsigned char*>(data);
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < n; ++i) {
+      h ^= p[i];
+      h *= 0x100000001b3ULL;
+    }
+    return h;
+  }
+
+  /// Clave en hexadecimal, para mostrarla.
+  static std::string
+  toHex(const std::string& key) {
+    std::ostringstream oss;
+    for (unsigned char c : key) {
+      oss << std::hex << std::setw(2) << std::setfill('0') << int(c);
+    }
+    return oss.str();
+  }
+
+private:
+  static constexpr const char* kMagic = "CRIPTARC";
+  static constexpr const char* kIndexMagic = "CRIPTIDX";
+  static constexpr uint32_t kVersion = 2;
+  static constexpr uint32_t kFlagStored = 1;
+  static constexpr uint64_t kHeaderSize = 20;
+  static constexpr uint64_t kFooterSize = 24;
+  static constexpr uint64_t kRecordSize = 40;
+
+  mutable std::mutex m_mtx;
+  TopK<std::string> m_best;
+
+  // Aade p a la lista o, si su clave ya est, conserva el mejor puntaje.
+  template <typename Pending>
+  static void
+  keep(std::vector<Pending>& list, Pending p) {
+    for (Pending& q : list) {
+      if (q.entry.key != p.entry.key) continue;
+      if (p.entry.score > q.entry.score) q.entry.score = p.entry.score;
+      return;
+    }
+    list.push_back(std::move(p));
+  }
+
+  // Nombre libre en el mismo directorio que path, para que el rename final
+  // no cruce sistemas de archivos.
+  static std::string
+  tempPathFor(const std::string& path) {
+    std::random_device rd;
+    for (int attempt = 0; attempt < 16; ++attempt) {
+      std::ostringstream name;
+      name << path << ".tmp" << std::hex << rd() << rd();
+      if (!fs::exists(name.str())) return name.str();
+    }
+    throw std::runtime_error("No se pudo crear un temporal para: " + path);
+  }
+
+  // Huella guardada en la cabecera, si el archivo existe, tiene ndice y
+  // es de esta versin; si no, nullopt.
+  static std::optional<uint64_t>
+  sourceOf(const std::string& path) {
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in) return std::nullopt;
+    const uint64_t size = static_cast<uint64_t>(in.tellg());
+    if (size < kHeaderSize + kFooterSize) return std::nullopt;
+    char magic[8];
+    in.seekg(0);
+    in.read(magic, 8);
+    if (std::memcmp(magic, kMagic, 8) != 0 || getU32(in) != kVersion) return std::nullopt;
+    uint64_t source = getU64(in);
+    if (!in) return std::nullopt;
+    return source;
+  }
+
+  static void
+  putU32(std::ostream& out, uint32_t v) {
+    unsigned char b[4];
+    for (int i = 0; i < 4; ++i) b[i] = static_cast<unsigned char>(v >> (8 * i));
+    out.write(reinterpret_cast<const char*>(b), 4);
+  }
+
+  static void
+  putU64(std::ostream& out, uint64_t v) {
+    unsigned char b[8];
+    for (int i = 0; i < 8; ++i) b[i] = static_cast<unsigned char>(v >> (8 * i));
+    out.write(reinterpret_cast<const char*>(b), 8);
+  }
+
+  static void
+  putF64(std::ostream& out, double v) {
+    uint64_t bits;
+    std::memcpy(&bits, &v, 8);
+    putU64(out, bits);
+  }
+
+  static uint32_t
+  getU32(std::istream& in) {
+    unsigned char b[4] = {};
+    in.read(reinterpret_cast<char*>(b), 4);
+    uint32_t v = 0;
+    for (int i = 0; i < 4; ++i) v |= uint32_t(b[i]) << (8 * i);
+    return v;
+  }
+
+  static uint64_t
+  getU64(std::istream& in) {
+    unsigned char b[8] = {};
+    in.read(reinterpret_cast<char*>(b), 8);
+    uint64_t v = 0;
+    for (int i = 0; i < 8; ++i) v |= uint64_t(b[i]) << (8 * i);
+    return v;
+  }
+
+  static double
+  getF64(std::istream& in) {
+    uint64_t bits = getU64(in);
+    double v;
+    std::memcpy(&v, &bits, 8);
+    return v;
+  }
+};
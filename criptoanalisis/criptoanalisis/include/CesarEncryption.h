@@ -1,5 +1,28 @@
 #pragma once
 #include "Prerequisites.h"
+#include "CandidateArchive.h"
+#include "Simd.h"
+#include "TextStatistics.h"
+
+/// Tablas de traduccin de los 26 desplazamientos, generadas en tiempo de
+/// compilacin: kCesarTables[s][c] es el byte c con sus letras desplazadas
+/// s posiciones. Los dgitos dependen del desplazamiento mdulo 10 y se
+/// completan al preparar cada transformacin.
+constexpr std::array<std::array<unsigned char, 256>, 26>
+buildCesarTables() {
+	std::array<std::array<unsigned char, 256>, 26> tables{};
+	for (int s = 0; s < 26; ++s) {
+		for (int c = 0; c < 256; ++c) {
+			int out = c;
+			if (c >= 'A' && c <= 'Z') out = (c - 'A' + s) % 26 + 'A';
+			else if (c >= 'a' && c <= 'z') out = (c - 'a' + s) % 26 + 'a';
+			tables[s][c] = static_cast<unsigned char>(out);
+		}
+	}
+	return tables;
+}
+
+inline constexpr auto kCesarTables = buildCesarTables();
 
 class
 	CesarEncryption {
@@ -8,34 +31,45 @@ public:
 	~CesarEncryption() = default;
 
 	std::string
-	encode(const std::string& texto, int desplazamiento) {
-		std::string result = "";
+	encode(const std::string& texto, int desplazamiento) const {
+		std::string result(texto.size(), '\0');
+		encodeInto(texto.data(), texto.size(), &result[0], desplazamiento);
+		return result;
+	}
 
-		for (char c : texto) {
-			if (c >= 'A' && c <= 'Z') {
-				result += (char)(((c - 'A' + desplazamiento) % 26) + 'A');
-			}
-			else if (c >= 'a' && c <= 'z') {
-				result += (char)(((c - 'a' + desplazamiento) % 26) + 'a');
-			}
-			else if (c >= '0' && c <= '9') {
-				result += (char)(((c - '0' + desplazamiento) % 10) + '0');
-			}
-			else {
-				result += c;
-			}
-		}
+	/// Escribe en 'out' (n bytes ya reservados) el texto desplazado. Letras y
+	/// dgitos se transforman igual que siempre, pero sin ramas por carcter:
+	/// AVX2 o SSE2 (comparaciones de rango y suma) con tabla de 256 bytes
+	/// como respaldo. 'in' y 'out' pueden ser el mismo buffer.
+	static void
+	encodeInto(const char* in, size_t n, char* out, int desplazamiento) {
+		const int s = ((desplazamiento % 26) + 26) % 26;
+		const int sd = ((desplazamiento % 10) + 10) % 10;
+		const auto* src = reinterpret_cast<const unsigned char*>(in);
+		auto* dst = reinterpret_cast<unsigned char*>(out);
 
-		return result;
+		size_t done = 0;
+#if defined(CRIPTO_X86)
+		if (Simd::hasAVX2()) {
+			done = shiftAVX2(src, dst, n, s, sd);
+		}
+		else if (Simd::hasSSE2()) {
+			done = shiftSSE2(src, dst, n, s, sd);
+		}
+#endif
+		if (done < n) {
+			auto table = translationTable(s, sd);
+			for (size_t i = done; i < n; ++i) dst[i] = table[src[i]];
+		}
 	}
 
 	std::string
-	decode(const std::string& texto, int desplazamiento) {
+	decode(const std::string& texto, int desplazamiento) const {
 		return encode(texto, 26 - (desplazamiento % 26));
 	}
 
 	void
-	bruteForceAttack(const std::string& texto) {
+	bruteForceAttack(const std::string& texto) const {
 		std::cout << "\nIntentos de descifrado por fuerza bruta:\n";
 		for (int clave = 0; clave < 26; clave++) {
 			std::string intento = encode(texto, 26 - clave);
@@ -43,64 +77,66 @@ public:
 		}
 	}
 
-	int
-	evaluatePossibleKey(const std::string& texto) {
-		int frecuencias[26] = { 0 };
-
-		// Contar frecuencias de letras
-		for (char c : texto) {
-			if (c >= 'a' && c <= 'z') {
-				frecuencias[c - 'a']++;
-			}
-			else if (c >= 'A' && c <= 'Z') {
-				frecuencias[c - 'A']++;
-			}
-		}
-
-		// Letras comunes en espaol (orden de frecuencia)
-		const char letrasEsp[] = { 'e', 'a', 'o', 's', 'r', 'n', 'i', 'd', 'l', 'c' };
+	/// Resultado del ataque por frecuencias.
+	struct CrackResult {
+		int clave = 0;                ///< Desplazamiento a usar con decode().
+		TextStatistics::Language idioma = TextStatistics::Language::Spanish;
+		double chi = 0.0;             ///< Chi-cuadrado del ganador (menor es mejor).
+	};
 
-		// Buscar la letra ms frecuente en el mensaje cifrado
-		int indiceMax = 0;
-		for (int i = 1; i < 26; ++i) {
-			if (frecuencias[i] > frecuencias[indiceMax]) {
-				indiceMax = i;
-			}
-		}
-
-		// Probar varias suposiciones de mapeo
-		int mejorClave = 0;
-		int mejorPuntaje = -1;
-
-		for (char letraRef : letrasEsp) {
-			int clave = (indiceMax - (letraRef - 'a') + 26) % 26;
-			int puntaje = 0;
-
-			// Descifrar con esa clave
-			std::string descifrado = encode(texto, 26 - clave);
+	int
+	evaluatePossibleKey(const std::string& texto) const {
+		return crackKey(texto.data(), texto.size()).clave;
+	}
 
-			// Palabras comunes simples
-			std::string comunes[] = { "el", "de", "la", "que", "en", "y", "los", "se" };
+	/// Recupera la clave sin descifrar: un histograma de letras en una pasada
+	/// y, para cada uno de los 26 desplazamientos, el chi-cuadrado de las
+	/// cuentas rotadas contra el espaol y el ingls. Cuesta O(n + 2626).
+	static CrackResult
+	crackKey(const char* data, size_t n) {
+		std::array<uint64_t, 256> hist;
+		TextStatistics::byteHistogram(reinterpret_cast<const unsigned char*>(data), n, hist);
+		uint64_t letras[26];
+		uint64_t total = TextStatistics::letterCounts(hist, letras);
 
-			for (std::string palabra : comunes) {
-				if (descifrado.find(palabra) != std::string::npos) {
-					puntaje++;
+		CrackResult best;
+		best.chi = std::numeric_limits<double>::infinity();
+		const TextStatistics::Language idiomas[] = {
+			TextStatistics::Language::Spanish, TextStatistics::Language::English };
+		for (int clave = 0; clave < 26; ++clave) {
+			// La letra clara i aparece cifrada como (i + clave) % 26
+			uint64_t rotadas[26];
+			for (int i = 0; i < 26; ++i) rotadas[i] = letras[(i + clave) % 26];
+			for (auto idioma : idiomas) {
+				double chi = TextStatistics::chiSquared(rotadas, total, idioma);
+				if (chi < best.chi) {
+					best.chi = chi;
+					best.clave = clave;
+					best.idioma = idioma;
 				}
 			}
-
-			if (puntaje > mejorPuntaje) {
-				mejorPuntaje = puntaje;
-				mejorClave = clave;
-			}
 		}
+		return best;
+	}
 
-		return mejorClave;
+	/// Rompe un archivo cifrado: estima la clave con crackKey y descifra
+	/// solo con el desplazamiento ganador.
+	CrackResult
+	crackFile(const std::string& inputPath,
+		const std::string& outputPath) const {
+		std::string contenido = readFile(inputPath);
+		CrackResult r = crackKey(contenido.data(), contenido.size());
+		writeFile(outputPath, decode(contenido, r.clave));
+		std::cout << "Clave estimada: " << r.clave
+			<< (r.idioma == TextStatistics::Language::Spanish ? " (espaol" : " (ingls")
+			<< ", chi2=" << r.chi << ")" << std::endl;
+		return r;
 	}
 
 	void 
 	encryptFile(const std::string& inputPath,
 							const std::string& outputPath,
-							int desplazamiento)	{
+							int desplazamiento) const {
 		std::string contenido = readFile(inputPath);
 		std::string cifrado = encode(contenido, desplazamiento);
 		writeFile(outputPath, cifrado);
@@ -109,29 +145,147 @@ public:
 	void 
 	decryptFile(const std::string& inputPath,
 							const std::string& outputPath,
-							int desplazamiento) {
+							int desplazamiento) const {
 		std::string contenido = readFile(inputPath);
 		std::string claro = decode(contenido, desplazamiento);
 		writeFile(outputPath, claro);
 	}
 
-	/// Genera N=26 archivos con nombre base + clave, por ejemplo: "salida_0.txt", "salida_1.txt", ...
+	/// Prueba las 26 claves y guarda las maxResults mejores, ordenadas por
+	/// puntaje, en un nico archivo: outputDir/baseName.cand (ver CandidateArchive).
+	/// La clave se guarda como un byte con el desplazamiento; con keyOnly no se
+	/// guarda el texto, que se regenera con decode() al leer.
 	void 
 	bruteForceFile(const std::string& inputPath,
 		const std::string& outputDir,
-		const std::string& baseName) {
+		const std::string& baseName,
+		size_t maxResults = 5,
+		bool keyOnly = false) const {
 		std::string contenido = readFile(inputPath);
+
+		// Una sola pasada: el puntaje es una suma por byte, as que el de cada
+		// desplazamiento se obtiene del histograma de bytes sin descifrar nada.
+		std::array<uint64_t, 256> hist;
+		TextStatistics::byteHistogram(
+			reinterpret_cast<const unsigned char*>(contenido.data()), contenido.size(), hist);
+		const auto& logp = TextStatistics::byteLogProbabilities();
+
+		CandidateArchive archive(maxResults);
 		for (int clave = 0; clave < 26; clave++) {
-			std::string descifrado = encode(contenido, 26 - clave);
-			std::ostringstream filename;
-			filename << outputDir << "/" << baseName << "_" << clave << ".txt";
-			writeFile(filename.str(), descifrado);
+			auto table = translationTable(26 - clave, (26 - clave) % 10);
+			double sum = 0.0;
+			for (int b = 0; b < 256; ++b) {
+				if (hist[b]) sum += double(hist[b]) * logp[table[b]];
+			}
+			double score = contenido.empty() ? 0.0 : sum / double(contenido.size());
+			archive.offer(score, std::string(1, static_cast<char>(clave)));
 		}
+
+		fs::create_directories(outputDir);
+		std::string path = outputDir + "/" + baseName + ".cand";
+		const uint64_t source = CandidateArchive::fingerprint(contenido.data(), contenido.size());
+		size_t count = archive.commit(path, source, [&](const std::string& key) {
+			return encode(contenido, 26 - static_cast<unsigned char>(key[0]));
+			}, keyOnly);
+		for (const auto& e : archive.ranking()) {
+			std::cout << "Clave " << int(static_cast<unsigned char>(e.value[0]))
+				<< "  score=" << e.score << std::endl;
+		}
+		std::cout << "Guardado: " << path << " (" << count << " candidatos)" << std::endl;
 	}
 
 	private:
+		/// Tabla completa para un desplazamiento: letras (s) y dgitos (sd).
+		static std::array<unsigned char, 256>
+		translationTable(int s, int sd) {
+			std::array<unsigned char, 256> table = kCesarTables[s % 26];
+			for (int d = 0; d < 10; ++d) {
+				table['0' + d] = static_cast<unsigned char>('0' + (d + sd) % 10);
+			}
+			return table;
+		}
+
+#if defined(CRIPTO_X86)
+		// Tres rangos: maysculas y minsculas con desplazamiento s mdulo 26,
+		// dgitos con sd mdulo 10. Los bytes de un rango suman k, o k - m si
+		// se pasaran del final del rango. Las comparaciones son con signo, as
+		// los bytes >= 0x80 nunca caen en un rango y quedan intactos.
+		struct ShiftRanges {
+			char lo[3], hi[3], wrap[3], add[3], addWrapped[3];
+
+			ShiftRanges(int s, int sd) {
+				const char first[3] = { 'A', 'a', '0' }, last[3] = { 'Z', 'z', '9' };
+				const int k[3] = { s, s, sd }, m[3] = { 26, 26, 10 };
+				for (int r = 0; r < 3; ++r) {
+					lo[r] = char(first[r] - 1);
+					hi[r] = char(last[r] + 1);
+					wrap[r] = char(last[r] - k[r]);
+					add[r] = char(k[r]);
+					addWrapped[r] = char(k[r] - m[r]);
+				}
+			}
+		};
+
+		CRIPTO_TARGET("sse2")
+		static size_t
+		shiftSSE2(const unsigned char* src, unsigned char* dst, size_t n, int s, int sd) {
+			const ShiftRanges rg(s, sd);
+			__m128i lo[3], hi[3], wrap[3], add[3], addWrapped[3];
+			for (int r = 0; r < 3; ++r) {
+				lo[r] = _mm_set1_epi8(rg.lo[r]);
+				hi[r] = _mm_set1_epi8(rg.hi[r]);
+				wrap[r] = _mm_set1_epi8(rg.wrap[r]);
+				add[r] = _mm_set1_epi8(rg.add[r]);
+				addWrapped[r] = _mm_set1_epi8(rg.addWrapped[r]);
+			}
+
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) {
+				__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+				__m128i delta = _mm_setzero_si128();
+				for (int r = 0; r < 3; ++r) {
+					__m128i in = _mm_and_si128(_mm_cmpgt_epi8(v, lo[r]), _mm_cmplt_epi8(v, hi[r]));
+					__m128i wrapped = _mm_cmpgt_epi8(v, wrap[r]);
+					__m128i k = _mm_or_si128(_mm_and_si128(wrapped, addWrapped[r]),
+						_mm_andnot_si128(wrapped, add[r]));
+					delta = _mm_or_si128(delta, _mm_and_si128(in, k));
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_add_epi8(v, delta));
+			}
+			return i;
+		}
+
+		CRIPTO_TARGET("avx2")
+		static size_t
+		shiftAVX2(const unsigned char* src, unsigned char* dst, size_t n, int s, int sd) {
+			const ShiftRanges rg(s, sd);
+			__m256i lo[3], hi[3], wrap[3], add[3], addWrapped[3];
+			for (int r = 0; r < 3; ++r) {
+				lo[r] = _mm256_set1_epi8(rg.lo[r]);
+				hi[r] = _mm256_set1_epi8(rg.hi[r]);
+				wrap[r] = _mm256_set1_epi8(rg.wrap[r]);
+				add[r] = _mm256_set1_epi8(rg.add[r]);
+				addWrapped[r] = _mm256_set1_epi8(rg.addWrapped[r]);
+			}
+
+			size_t i = 0;
+			for (; i + 32 <= n; i += 32) {
+				__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+				__m256i delta = _mm256_setzero_si256();
+				for (int r = 0; r < 3; ++r) {
+					__m256i in = _mm256_and_si256(_mm256_cmpgt_epi8(v, lo[r]), _mm256_cmpgt_epi8(hi[r], v));
+					__m256i wrapped = _mm256_cmpgt_epi8(v, wrap[r]);
+					__m256i k = _mm256_blendv_epi8(add[r], addWrapped[r], wrapped);
+					delta = _mm256_or_si256(delta, _mm256_and_si256(in, k));
+				}
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), _mm256_add_epi8(v, delta));
+			}
+			return i;
+		}
+#endif
+
 		std::string 
-		readFile(const std::string& path) {
+		readFile(const std::string& path) const {
 			std::ifstream in(path, std::ios::in | std::ios::binary);
 			if (!in) throw std::runtime_error("No se pudo abrir para lectura: " + path);
 			std::ostringstream ss;
@@ -140,7 +294,7 @@ public:
 		}
 
 		void 
-		writeFile(const std::string& path, const std::string& data) {
+		writeFile(const std::string& path, const std::string& data) const {
 			std::ofstream out(path, std::ios::out | std::ios::binary);
 			if (!out) throw std::runtime_error("No se pudo abrir para escritura: " + path);
 			out << data;
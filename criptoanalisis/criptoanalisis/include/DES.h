@@ -1,6 +1,20 @@
 #pragma once
 #include "Prerequisites.h"
-
+#include "CandidateArchive.h"
+#include "CryptoGenerator.h"
+#include "DESBitslice.h"
+#include "DESKeySearch.h"
+#include "TextStatistics.h"
+#include "ThreadPool.h"
+
+/**
+ * @class DES
+ * @brief DES (FIPS 46-3) sobre bloques de 64 bits en uint64_t big-endian.
+ *
+ * La funcin f usa las cajas SP (S + P combinadas, DESTables::spBoxes) y
+ * la expansin E sale de rotar la mitad derecha; IP y FP se hacen con cinco
+ * intercambios de bits (delta swaps) en lugar de bit a bit.
+ */
 class DES {
 public:
   // --- Constructores y generacin de subclaves ---
@@ -12,60 +26,146 @@ public:
 
   void setKey(const std::bitset<64>& key_) {
     key = key_;
-    subkeys.clear();
     generateSubkeys();
   }
 
   // --- Bloque de 64 bits (1 bloque) ---
+  uint64_t 
+  encodeBlock(uint64_t plaintext) const {
+    return crypt<true>(plaintext);
+  }
+
+  uint64_t 
+  decodeBlock(uint64_t ciphertext) const {
+    return crypt<false>(ciphertext);
+  }
+
   std::bitset<64> 
-  encodeBlock(const std::bitset<64>& plaintext) {
-    auto data = iPermutation(plaintext);
-    auto left = std::bitset<32>((data.to_ullong() >> 32));
-    auto right = std::bitset<32>(data.to_ullong());
+  encodeBlock(const std::bitset<64>& plaintext) const {
+    return std::bitset<64>(encodeBlock(uint64_t(plaintext.to_ullong())));
+  }
 
-    for (int round = 0; round < 16; ++round) {
-      auto f = feistel(right, subkeys[round]);
-      auto newR = left ^ f;
-      left = right;
-      right = newR;
+  std::bitset<64> 
+  decodeBlock(const std::bitset<64>& ciphertext) const {
+    return std::bitset<64>(decodeBlock(uint64_t(ciphertext.to_ullong())));
+  }
+
+  // --- Varios bloques a la vez ---
+  // Cifran 'count' bloques en su sitio. Avanzan kInterleave bloques juntos
+  // ronda por ronda: sus consultas a las cajas SP no dependen entre s y la
+  // CPU las solapa en lugar de esperar cada una.
+  void 
+  encodeBlocks(uint64_t* blocks, size_t count) const {
+    cryptBlocks<true>(blocks, count);
+  }
+
+  void 
+  decodeBlocks(uint64_t* blocks, size_t count) const {
+    cryptBlocks<false>(blocks, count);
+  }
+
+  // --- Modos de operacin ---
+  enum class Mode {
+    ECB,  ///< Bloques independientes, relleno con ceros (formato original).
+    CBC,  ///< Encadenado: IV de 8 bytes al inicio y relleno PKCS#7.
+    CTR   ///< Contador: IV de 8 bytes al inicio, sin relleno.
+  };
+
+  /// Cifra un buffer; en CBC y CTR el IV sale de CryptoGenerator::generateIV.
+  std::string 
+  encryptBuffer(const std::string& data, Mode mode = Mode::ECB) const {
+    return encryptBuffer(data, mode, mode == Mode::ECB ? 0 : randomIV());
+  }
+
+  /// Cifra un buffer con un IV dado (se ignora en ECB).
+  std::string 
+  encryptBuffer(const std::string& data, Mode mode, uint64_t iv) const {
+    switch (mode) {
+    case Mode::ECB:
+      return processBuffer(data, /*encrypt=*/true);
+    case Mode::CBC: {
+      // IV + datos + PKCS#7 (1..8 bytes, siempre al menos uno)
+      std::string out(8 + (data.size() / 8 + 1) * 8, '\0');
+      writeBlock(out, 0, iv);
+      std::memcpy(&out[8], data.data(), data.size());
+      std::fill(out.begin() + 8 + data.size(), out.end(), char(8 - data.size() % 8));
+      // Cada bloque depende del anterior: CBC cifra en serie
+      uint64_t prev = iv;
+      for (size_t off = 8; off < out.size(); off += 8) {
+        prev = encodeBlock(loadBE(&out[off]) ^ prev);
+        storeBE(&out[off], prev);
+      }
+      return out;
     }
-    uint64_t combined = (uint64_t(right.to_ullong()) << 32) | left.to_ullong();
-    return fPermutation(std::bitset<64>(combined));
+    case Mode::CTR: {
+      std::string out(8 + data.size(), '\0');
+      writeBlock(out, 0, iv);
+      std::memcpy(&out[8], data.data(), data.size());
+      applyCounter(out, 8, iv);
+      return out;
+    }
+    }
+    throw std::invalid_argument("Modo de operacin desconocido.");
   }
 
-  std::bitset<64> 
-  decodeBlock(const std::bitset<64>& ciphertext) {
-    auto data = iPermutation(ciphertext);
-    auto left = std::bitset<32>((data.to_ullong() >> 32));
-    auto right = std::bitset<32>(data.to_ullong());
-
-    for (int round = 15; round >= 0; --round) {
-      auto f = feistel(right, subkeys[round]);
-      auto newR = left ^ f;
-      left = right;
-      right = newR;
+  /// Inversa de encryptBuffer. En CBC valida el relleno PKCS#7.
+  std::string 
+  decryptBuffer(const std::string& data, Mode mode = Mode::ECB) const {
+    switch (mode) {
+    case Mode::ECB:
+      return processBuffer(data, /*encrypt=*/false);
+    case Mode::CBC: {
+      if (data.size() < 16 || data.size() % 8 != 0) {
+        throw std::runtime_error("Texto cifrado CBC invlido: longitud " + std::to_string(data.size()));
+      }
+      // P_i = D(C_i) ^ C_(i-1): los bloques no dependen entre s al descifrar
+      std::string out(data.size() - 8, '\0');
+      parallelBlocks(out.size() / 8, [&](size_t begin, size_t end) {
+        cryptBytes<false>(data.data() + begin * 8 + 8, &out[begin * 8], end - begin);
+        for (size_t i = begin; i < end; ++i) {
+          storeBE(&out[i * 8], loadBE(&out[i * 8]) ^ loadBE(data.data() + i * 8));
+        }
+        });
+      const unsigned char pad = static_cast<unsigned char>(out.back());
+      if (pad < 1 || pad > 8
+        || std::count(out.end() - pad, out.end(), char(pad)) != pad) {
+        throw std::runtime_error("Relleno PKCS#7 invlido (clave incorrecta?).");
+      }
+      out.resize(out.size() - pad);
+      return out;
     }
-    uint64_t combined = (uint64_t(right.to_ullong()) << 32) | left.to_ullong();
-    return fPermutation(std::bitset<64>(combined));
+    case Mode::CTR: {
+      if (data.size() < 8) throw std::runtime_error("Texto cifrado CTR sin IV.");
+      std::string out = data.substr(8);
+      applyCounter(out, 0, readBlock(data, 0));
+      return out;
+    }
+    }
+    throw std::invalid_argument("Modo de operacin desconocido.");
   }
 
   // --- Encriptar / Decriptar archivos ---
   void 
   encryptFile(const std::string& inPath,
-    const std::string& outPath)
+    const std::string& outPath,
+    Mode mode = Mode::ECB)
   {
-    processFile(inPath, outPath, /*encrypt=*/true);
+    writeFile(outPath, encryptBuffer(readFile(inPath), mode));
   }
 
   void 
   decryptFile(const std::string& inPath,
-    const std::string& outPath)
+    const std::string& outPath,
+    Mode mode = Mode::ECB)
   {
-    processFile(inPath, outPath, /*encrypt=*/false);
+    writeFile(outPath, decryptBuffer(readFile(inPath), mode));
   }
 
   // --- Brute force de demostracin ---
-  // 1) Sobre un solo bloque conocido: recorre hasta maxKeys y retorna las claves que coinciden
+  // 1) Sobre un solo bloque conocido: retorna, ordenadas, las claves k < maxKeys
+  //    que descifran cipherBlock en knownPlain. Usa DESKeySearch: recorre
+  //    ndices de 56 bits (las claves que solo difieren en la paridad
+  //    son equivalentes) y luego expande cada acierto a sus 256 paridades.
   std::vector<uint64_t> 
   bruteForceKnownPlaintextBlock(
     const std::bitset<64>& cipherBlock,
@@ -73,100 +173,263 @@ public:
     uint64_t maxKeys = (1ULL << 20)  // por defecto: 2^20 claves
   ) {
     std::vector<uint64_t> found;
-    for (uint64_t k = 0; k < maxKeys; ++k) {
-      setKey(std::bitset<64>(k));
-      if (decodeBlock(cipherBlock) == knownPlain) {
-        found.push_back(k);
+    if (maxKeys == 0) return found;
+
+    const uint64_t plain = knownPlain.to_ullong();
+    const uint64_t cipher = cipherBlock.to_ullong();
+    // compressKey es montona, as que basta llegar al ndice de maxKeys - 1
+    const uint64_t indices = DESBitslice::compressKey(maxKeys - 1) + 1;
+
+    DESKeySearch::Options options;
+    options.stopAtFirst = false;
+    DESKeySearch::Result r = DESKeySearch::search(plain, cipher, 0, indices, options,
+      ThreadPool::shared());
+
+    for (uint64_t e : r.keys) {
+      const uint64_t base = DESBitslice::expandKey56(e);
+      for (uint64_t parity = 0; parity < 256; ++parity) {
+        uint64_t k = base;
+        for (int i = 0; i < 8; ++i) k |= ((parity >> i) & 1) << (8 * i);
+        if (k < maxKeys) found.push_back(k);
       }
     }
+    std::sort(found.begin(), found.end());
     return found;
   }
 
   // 2) Sobre un archivo con bloque conocido al inicio:
-  //    genera archivos descifrados con cada clave hasta maxKeys
+  //    por cada clave hasta maxKeys descifra solo los primeros bloques y
+  //    descarta la clave si no empiezan con knownHeader (o, sin cabecera,
+  //    si no parecen texto; ver looksLikeText). Solo las claves que pasan
+  //    descifran el archivo completo, se puntan y compiten por los
+  //    maxResults puestos de outDir/des.cand (ver CandidateArchive). La
+  //    clave se guarda en 8 bytes big-endian.
   void 
   bruteForceFile(const std::string& inPath,
     const std::string& outDir,
-    uint64_t maxKeys = (1ULL << 20))
+    uint64_t maxKeys = (1ULL << 20),
+    size_t maxResults = 16,
+    bool keyOnly = false,
+    const std::string& knownHeader = "")
   {
     // leer todo el archivo
     auto data = readFile(inPath);
-    // extraer primer bloque de 8 bytes
-    std::bitset<64> cipherBlock = readBlock(data, 0);
+    const size_t blocks = (data.size() + 7) / 8;
+    const size_t headBlocks = std::min(blocks,
+      std::max(kFilterBlocks, (knownHeader.size() + 7) / 8));
+    const size_t headBytes = std::min(data.size(), headBlocks * 8);
+    if (knownHeader.size() > data.size()) {
+      throw std::invalid_argument("La cabecera conocida es ms larga que el archivo.");
+    }
+
+    // primeros bloques cifrados (con el mismo relleno que processBuffer)
+    std::string padded = data.substr(0, headBlocks * 8);
+    padded.resize(headBlocks * 8, '\0');
+    std::vector<uint64_t> cipherBlocks(headBlocks);
+    for (size_t i = 0; i < headBlocks; ++i) cipherBlocks[i] = readBlock(padded, i * 8);
 
+    CandidateArchive archive(maxResults);
+    std::string head(headBlocks * 8, '\0');
+    uint64_t passed = 0;
     for (uint64_t k = 0; k < maxKeys; ++k) {
       setKey(std::bitset<64>(k));
-      // si el primer bloque descifra a algo legible (aqu sin chequear),
-      // de todas formas guardamos el intento:
+      // Etapa 1: solo la cabecera
+      for (size_t i = 0; i < headBlocks; ++i) writeBlock(head, i * 8, decodeBlock(cipherBlocks[i]));
+      bool ok = knownHeader.empty()
+        ? looksLikeText(head.data(), headBytes)
+        : head.compare(0, knownHeader.size(), knownHeader) == 0;
+      if (!ok) continue;
+
+      // Etapa 2: archivo completo
+      ++passed;
       std::string out = processBuffer(data, /*encrypt=*/false);
-      std::ostringstream oss;
-      oss << outDir << "/decrypted_" << k << ".bin";
-      writeFile(oss.str(), out);
+      double score = TextStatistics::meanLogProbability(
+        reinterpret_cast<const unsigned char*>(out.data()), out.size());
+      archive.offer(score, keyBytes(k));
     }
+
+    fs::create_directories(outDir);
+    std::string path = outDir + "/des.cand";
+    const uint64_t source = CandidateArchive::fingerprint(data.data(), data.size());
+    size_t count = archive.commit(path, source, [&](const std::string& kb) {
+      setKey(std::bitset<64>(keyValue(kb)));
+      return processBuffer(data, /*encrypt=*/false);
+      }, keyOnly);
+    std::cout << "Filtro de cabecera: " << passed << " de " << maxKeys << " claves\n";
+    std::cout << "Guardado: " << path << " (" << count << " candidatos)\n";
   }
 
 private:
+  static constexpr size_t kFilterBlocks = 4;        ///< Bloques de la etapa 1 sin cabecera conocida.
+  static constexpr size_t kChunkBlocks = 1 << 13;   ///< Bloques por tramo paralelo (64 KiB).
+  static constexpr size_t kInterleave = 8;          ///< Bloques intercalados por ronda.
+
   std::bitset<64> key;
-  std::vector<std::bitset<48>> subkeys;
+  std::array<uint64_t, 16> subkeys{};  ///< 48 bits por ronda, 6 por caja S (caja 1 arriba).
+
+  static constexpr std::array<std::array<uint32_t, 64>, 8> kSP = DESTables::spBoxes();
 
-  // --- Tablas (simplificadas en tu cdigo original) ---
-  const int EXPANSION_TABLE[48] = { /*  tu tabla  */ };
-  const int P_TABLE[32] = { /*  tu tabla  */ };
-  const int SBOX[4][16] = { /*  tu SBOX  */ };
+  // Cada bit de subclave es un bit fijo de la clave (DESTables::subkeyBits),
+  // as que la subclave de una ronda es el OR de lo que aporta cada byte de
+  // la clave: 8 consultas por ronda en lugar de PC1, rotaciones y PC2.
+  using SubkeyTable = std::array<std::array<std::array<uint64_t, 256>, 8>, 16>;
 
   void 
   generateSubkeys() {
-    for (int i = 0; i < 16; ++i) {
-      std::bitset<48> sub((key.to_ullong() >> i) & 0xFFFFFFFFFFFF);
-      subkeys.push_back(sub);
+    static const SubkeyTable table = buildSubkeyTable();
+    const uint64_t k = key.to_ullong();
+    for (int round = 0; round < 16; ++round) {
+      uint64_t sub = 0;
+      for (int i = 0; i < 8; ++i) sub |= table[round][i][(k >> (56 - 8 * i)) & 0xFF];
+      subkeys[round] = sub;
     }
   }
 
-  std::bitset<64> 
-  iPermutation(const std::bitset<64>& in) {
-    // identidad en tu ejemplo
-    return in;
+  static SubkeyTable 
+  buildSubkeyTable() {
+    SubkeyTable table{};
+    const auto bits = DESTables::subkeyBits();
+    for (int round = 0; round < 16; ++round) {
+      for (int i = 0; i < 48; ++i) {
+        const int n = bits[round][i] - 1;  // bit de la clave, desde 0
+        for (int v = 0; v < 256; ++v) {
+          if ((v >> (7 - n % 8)) & 1) table[round][n / 8][v] |= uint64_t(1) << (47 - i);
+        }
+      }
+    }
+    return table;
   }
-  std::bitset<64> 
-  fPermutation(const std::bitset<64>& in) {
-    // identidad en tu ejemplo
-    return in;
-  }
-  std::bitset<48> 
-  expand(const std::bitset<32>& half) {
-    std::bitset<48> out;
-    for (int i = 0; i < 48; ++i)
-      out[i] = half[32 - EXPANSION_TABLE[i]];
-    return out;
+
+  static uint32_t 
+  rotr(uint32_t v, unsigned n) {
+    return (v >> n) | (v << ((32 - n) & 31));
+  }
+
+  // Intercambia los bits de 'a' (desplazados n) y 'b' seleccionados por mask.
+  static void 
+  deltaSwap(uint32_t& a, uint32_t& b, unsigned n, uint32_t mask) {
+    const uint32_t t = ((a >> n) ^ b) & mask;
+    b ^= t;
+    a ^= t << n;
   }
-  std::bitset<32> 
-  substitute(const std::bitset<48>& in) {
-    std::bitset<32> out;
-    for (int i = 0; i < 8; ++i) {
-      int row = (in[i * 6] << 1) | in[i * 6 + 5];
-      int col = (in[i * 6 + 1] << 3) | (in[i * 6 + 2] << 2) | (in[i * 6 + 3] << 1) | in[i * 6 + 4];
-      int val = SBOX[row % 4][col % 16];
-      for (int j = 0; j < 4; ++j)
-        out[i * 4 + j] = (val >> (3 - j)) & 1;
+
+  // La caja s lee los bits 4s..4s+5 (norma, circular) de R: rotando R a la
+  // derecha 27 - 4s posiciones quedan en los 6 bits bajos.
+  static uint32_t 
+  feistel(uint32_t r, uint64_t k) {
+    return kSP[0][(rotr(r, 27) ^ (k >> 42)) & 0x3F]
+      ^ kSP[1][(rotr(r, 23) ^ (k >> 36)) & 0x3F]
+      ^ kSP[2][(rotr(r, 19) ^ (k >> 30)) & 0x3F]
+      ^ kSP[3][(rotr(r, 15) ^ (k >> 24)) & 0x3F]
+      ^ kSP[4][(rotr(r, 11) ^ (k >> 18)) & 0x3F]
+      ^ kSP[5][(rotr(r, 7) ^ (k >> 12)) & 0x3F]
+      ^ kSP[6][(rotr(r, 3) ^ (k >> 6)) & 0x3F]
+      ^ kSP[7][(rotr(r, 31) ^ k) & 0x3F];
+  }
+
+  static void 
+  initialPermutation(uint64_t block, uint32_t& l, uint32_t& r) {
+    l = static_cast<uint32_t>(block >> 32);
+    r = static_cast<uint32_t>(block);
+    deltaSwap(l, r, 4, 0x0F0F0F0F);
+    deltaSwap(l, r, 16, 0x0000FFFF);
+    deltaSwap(r, l, 2, 0x33333333);
+    deltaSwap(r, l, 8, 0x00FF00FF);
+    deltaSwap(l, r, 1, 0x55555555);
+  }
+
+  // FP sobre R16 L16: los mismos intercambios en orden inverso
+  static uint64_t 
+  finalPermutation(uint32_t l, uint32_t r) {
+    deltaSwap(r, l, 1, 0x55555555);
+    deltaSwap(l, r, 8, 0x00FF00FF);
+    deltaSwap(l, r, 2, 0x33333333);
+    deltaSwap(r, l, 16, 0x0000FFFF);
+    deltaSwap(r, l, 4, 0x0F0F0F0F);
+    return (uint64_t(r) << 32) | l;
+  }
+
+  template <bool Encrypt>
+  uint64_t 
+  crypt(uint64_t block) const {
+    uint32_t l, r;
+    initialPermutation(block, l, r);
+    for (int i = 0; i < 16; i += 2) {
+      l ^= feistel(r, subkeys[Encrypt ? i : 15 - i]);
+      r ^= feistel(l, subkeys[Encrypt ? i + 1 : 14 - i]);
     }
-    return out;
+    return finalPermutation(l, r);
+  }
+
+  // W bloques intercalados: cada ronda se aplica a todos antes de la siguiente
+  template <bool Encrypt, size_t W>
+  void 
+  cryptGroup(uint64_t* blocks) const {
+    uint32_t l[W], r[W];
+    for (size_t w = 0; w < W; ++w) initialPermutation(blocks[w], l[w], r[w]);
+    for (int i = 0; i < 16; i += 2) {
+      const uint64_t k0 = subkeys[Encrypt ? i : 15 - i];
+      const uint64_t k1 = subkeys[Encrypt ? i + 1 : 14 - i];
+      for (size_t w = 0; w < W; ++w) l[w] ^= feistel(r[w], k0);
+      for (size_t w = 0; w < W; ++w) r[w] ^= feistel(l[w], k1);
+    }
+    for (size_t w = 0; w < W; ++w) blocks[w] = finalPermutation(l[w], r[w]);
   }
-  std::bitset<32> 
-  permuteP(const std::bitset<32>& in) {
-    std::bitset<32> out;
-    for (int i = 0; i < 32; ++i)
-      out[i] = in[32 - P_TABLE[i]];
+
+  template <bool Encrypt>
+  void 
+  cryptBlocks(uint64_t* blocks, size_t count) const {
+    size_t i = 0;
+    for (; i + kInterleave <= count; i += kInterleave) cryptGroup<Encrypt, kInterleave>(blocks + i);
+    for (; i < count; ++i) blocks[i] = crypt<Encrypt>(blocks[i]);
+  }
+
+  // Bloques de 8 bytes big-endian de 'in' a 'out' (pueden coincidir)
+  template <bool Encrypt>
+  void 
+  cryptBytes(const char* in, char* out, size_t count) const {
+    uint64_t group[kInterleave];
+    size_t i = 0;
+    for (; i + kInterleave <= count; i += kInterleave) {
+      for (size_t w = 0; w < kInterleave; ++w) group[w] = loadBE(in + (i + w) * 8);
+      cryptGroup<Encrypt, kInterleave>(group);
+      for (size_t w = 0; w < kInterleave; ++w) storeBE(out + (i + w) * 8, group[w]);
+    }
+    for (; i < count; ++i) storeBE(out + i * 8, crypt<Encrypt>(loadBE(in + i * 8)));
+  }
+
+  // Sin bytes de control y con a lo sumo un cuarto de bytes >= 0x80
+  // (acentos en Latin-1/UTF-8). Un bloque aleatorio de 32 bytes pasa con
+  // probabilidad del orden de 1e-6.
+  static bool 
+  looksLikeText(const char* data, size_t n) {
+    const auto& readable = TextStatistics::readableBytes();
+    size_t high = 0;
+    for (size_t i = 0; i < n; ++i) {
+      const unsigned char c = static_cast<unsigned char>(data[i]);
+      if (c >= 0x80) ++high;
+      else if (!readable[c]) return false;
+    }
+    return high * 4 <= n;
+  }
+
+  // --- Clave de 64 bits <-> 8 bytes big-endian ---
+  static std::string 
+  keyBytes(uint64_t k) {
+    std::string out(8, '\0');
+    for (int i = 0; i < 8; ++i) out[i] = char((k >> ((7 - i) * 8)) & 0xFF);
     return out;
   }
-  std::bitset<32> 
-  feistel(const std::bitset<32>& r,
-    const std::bitset<48>& k)
-  {
-    return permuteP(substitute(expand(r) ^ k));
+
+  static uint64_t 
+  keyValue(const std::string& bytes) {
+    uint64_t k = 0;
+    for (unsigned char c : bytes) k = (k << 8) | c;
+    return k;
   }
 
   // --- I/O de archivos y padding cero ---
-  std::string 
+  static std::string 
   readFile(const std::string& path) {
     std::ifstream in(path, std::ios::binary);
     if (!in) throw std::runtime_error("No se pudo abrir: " + path);
@@ -175,26 +438,16 @@ private:
     return ss.str();
   }
 
-  void 
+  static void 
   writeFile(const std::string& path, const std::string& data) {
     std::ofstream out(path, std::ios::binary);
     if (!out) throw std::runtime_error("No se pudo escribir: " + path);
     out.write(data.data(), data.size());
   }
 
-  // Procesa el buffer completo (pad con ceros hasta mltiplo de 8)
-  void 
-  processFile(const std::string& inPath,
-    const std::string& outPath,
-    bool encrypt)
-  {
-    auto buf = readFile(inPath);
-    auto out = processBuffer(buf, encrypt);
-    writeFile(outPath, out);
-  }
-
+  // ECB: procesa el buffer completo (pad con ceros hasta mltiplo de 8)
   std::string 
-  processBuffer(const std::string& buf, bool encrypt) {
+  processBuffer(const std::string& buf, bool encrypt) const {
     std::string result;
     size_t n = buf.size();
     size_t padded = ((n + 7) / 8) * 8;
@@ -203,31 +456,89 @@ private:
     // copiar original y zeros
     std::memcpy(result.data(), buf.data(), n);
 
-    // por cada bloque de 8 bytes
-    for (size_t offset = 0; offset < padded; offset += 8) {
-      auto block = readBlock(result, offset);
-      auto outBlk = encrypt
-        ? encodeBlock(block)
-        : decodeBlock(block);
-      writeBlock(result, offset, outBlk);
-    }
+    // bloques de 8 bytes, por tramos en paralelo
+    parallelBlocks(padded / 8, [&](size_t begin, size_t end) {
+      char* p = &result[begin * 8];
+      if (encrypt) cryptBytes<true>(p, p, end - begin);
+      else cryptBytes<false>(p, p, end - begin);
+      });
     return result;
   }
 
-  std::bitset<64> 
+  // CTR: buf[start..] ^= E(iv), E(iv + 1), ... (el ltimo bloque puede ser parcial)
+  void 
+  applyCounter(std::string& buf, size_t start, uint64_t iv) const {
+    const size_t n = buf.size() - start;
+    parallelBlocks((n + 7) / 8, [&](size_t begin, size_t end) {
+      uint64_t ks[kInterleave];
+      for (size_t i = begin; i < end; i += kInterleave) {
+        const size_t count = std::min(kInterleave, end - i);
+        for (size_t w = 0; w < count; ++w) ks[w] = iv + i + w;
+        encodeBlocks(ks, count);
+        for (size_t w = 0; w < count; ++w) {
+          char* p = &buf[start + (i + w) * 8];
+          if (start + (i + w + 1) * 8 <= buf.size()) {
+            storeBE(p, loadBE(p) ^ ks[w]);
+          }
+          else {
+            for (size_t j = 0; p + j < buf.data() + buf.size(); ++j) p[j] ^= char(ks[w] >> ((7 - j) * 8));
+          }
+        }
+      }
+      });
+  }
+
+  // Reparte [0, blocks) en tramos de kChunkBlocks bloques entre los hilos
+  template <typename Fn>
+  static void 
+  parallelBlocks(size_t blocks, Fn&& fn) {
+    ThreadPool::shared().parallelFor(blocks, kChunkBlocks, [&](unsigned, size_t begin, size_t end) {
+      fn(begin, end);
+      });
+  }
+
+  static uint64_t 
+  randomIV() {
+    CryptoGenerator generator;
+    uint64_t iv = 0;
+    for (uint8_t b : generator.generateIV(8)) iv = (iv << 8) | b;
+    return iv;
+  }
+
+  static uint64_t 
   readBlock(const std::string& buf, size_t off) {
-    uint64_t val = 0;
-    for (int i = 0; i < 8; ++i)
-      val |= uint64_t(uint8_t(buf[off + i])) << ((7 - i) * 8);
-    return std::bitset<64>(val);
+    return loadBE(buf.data() + off);
   }
-  void 
-  writeBlock(std::string& buf, size_t off,
-    const std::bitset<64>& bits)
+  static void 
+  writeBlock(std::string& buf, size_t off, uint64_t val)
   {
-    uint64_t val = bits.to_ullong();
-    for (int i = 0; i < 8; ++i)
-      buf[off + i] = char((val >> ((7 - i) * 8)) & 0xFF);
+    storeBE(&buf[off], val);
+  }
+
+  // --- Palabras big-endian ledas y escritas directamente del buffer ---
+  static uint64_t 
+  loadBE(const char* p) {
+    uint64_t v;
+    std::memcpy(&v, p, 8);
+    return swapToBigEndian(v);
+  }
+
+  static void 
+  storeBE(char* p, uint64_t v) {
+    v = swapToBigEndian(v);
+    std::memcpy(p, &v, 8);
+  }
+
+  // Orden nativo <-> big-endian (la conversin es su propia inversa)
+  static uint64_t 
+  swapToBigEndian(uint64_t v) {
+#if defined(_MSC_VER)
+    return _byteswap_uint64(v);
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return v;
+#else
+    return __builtin_bswap64(v);
+#endif
   }
 };
 
@@ -0,0 +1,376 @@
+#pragma once
+#include "Prerequisites.h"
+#include "DESTables.h"
+#include "Simd.h"
+
+/**
+ * @class DESBitslice
+ * @brief DES en "bitslice" para bsqueda de claves con texto conocido.
+ *
+ * Cada variable guarda el mismo bit de DES para muchas claves a la vez:
+ * el bit i de la palabra es el valor para la clave i. As una operacin
+ * lgica avanza tantas claves como bits tiene la palabra (64 con uint64_t,
+ * 128 con SSE2, 256 con AVX2). La palabra se elige en tiempo de ejecucin
+ * con Simd, como en los dems kernels vectorizados.
+ *
+ * Las permutaciones y la expansin son solo ndices, la planificacin de
+ * claves no cuesta nada (cada bit de subclave es un bit fijo de la clave) y
+ * las cajas S se evalan como suma de minitrminos de sus 6 entradas.
+ *
+ * Las claves se recorren por su ndice de 56 bits (sin paridad); ver
+ * expandKey56() y compressKey().
+ */
+class
+DESBitslice {
+public:
+  /// Claves por palabra del camino ms ancho (AVX2). Un rango alineado a
+  /// kLanes lo est tambin para los caminos ms estrechos.
+  static constexpr unsigned kLanes = 256;
+
+  /// Claves por palabra del camino que usar search() en esta CPU.
+  static unsigned
+  lanes() {
+#if defined(CRIPTO_X86)
+    if (Simd::hasAVX2()) return 256;
+    if (Simd::hasSSE2()) return 128;
+#endif
+    return 64;
+  }
+
+  /// Clave de 64 bits con los bits de paridad a cero a partir de su ndice
+  /// de 56 bits (7 bits por byte, el byte ms significativo primero).
+  static constexpr uint64_t
+  expandKey56(uint64_t k56) {
+    uint64_t key = 0;
+    for (int i = 0; i < 8; ++i) key |= ((k56 >> (7 * i)) & 0x7F) << (8 * i + 1);
+    return key;
+  }
+
+  /// Inversa de expandKey56: descarta los bits de paridad.
+  static constexpr uint64_t
+  compressKey(uint64_t key) {
+    uint64_t k56 = 0;
+    for (int i = 0; i < 8; ++i) k56 |= ((key >> (8 * i + 1)) & 0x7F) << (7 * i);
+    return k56;
+  }
+
+  /**
+   * @brief Prueba los ndices de clave [begin, end) con un par conocido.
+   *
+   * Elige en tiempo de ejecucin entre AVX2, SSE2 o palabras de 64 bits.
+   *
+   * @param plain  Bloque claro (big-endian, como lo lee DES).
+   * @param cipher Bloque cifrado correspondiente.
+   * @param found  Recibe, en orden, los ndices de 56 bits que cifran plain en cipher.
+   */
+  static void
+  search(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+    std::vector<uint64_t>& found)
+  {
+#if defined(CRIPTO_X86)
+    if (Simd::hasAVX2()) return searchAVX2(plain, cipher, begin, end, found);
+    if (Simd::hasSSE2()) return searchSSE2(plain, cipher, begin, end, found);
+#endif
+    Kernel<ScalarOps>::search(plain, cipher, begin, end, found);
+  }
+
+private:
+  // --- Operaciones lgicas por ancho de palabra ---
+  struct ScalarOps {
+    struct Word {
+      uint64_t v;
+    };
+    static Word andW(Word a, Word b) { return { a.v & b.v }; }
+    static Word orW(Word a, Word b) { return { a.v | b.v }; }
+    static Word xorW(Word a, Word b) { return { a.v ^ b.v }; }
+    static Word andNotW(Word a, Word b) { return { ~a.v & b.v }; }  ///< ~a & b
+  };
+
+#if defined(CRIPTO_X86)
+  struct SSE2Ops {
+    struct Word {
+      __m128i v;
+    };
+    CRIPTO_TARGET("sse2") static Word andW(Word a, Word b) { return { _mm_and_si128(a.v, b.v) }; }
+    CRIPTO_TARGET("sse2") static Word orW(Word a, Word b) { return { _mm_or_si128(a.v, b.v) }; }
+    CRIPTO_TARGET("sse2") static Word xorW(Word a, Word b) { return { _mm_xor_si128(a.v, b.v) }; }
+    CRIPTO_TARGET("sse2") static Word andNotW(Word a, Word b) { return { _mm_andnot_si128(a.v, b.v) }; }
+  };
+
+  struct AVX2Ops {
+    struct Word {
+      __m256i v;
+    };
+    CRIPTO_TARGET("avx2") static Word andW(Word a, Word b) { return { _mm256_and_si256(a.v, b.v) }; }
+    CRIPTO_TARGET("avx2") static Word orW(Word a, Word b) { return { _mm256_or_si256(a.v, b.v) }; }
+    CRIPTO_TARGET("avx2") static Word xorW(Word a, Word b) { return { _mm256_xor_si256(a.v, b.v) }; }
+    CRIPTO_TARGET("avx2") static Word andNotW(Word a, Word b) { return { _mm256_andnot_si256(a.v, b.v) }; }
+  };
+
+  // Todo el kernel se aplana dentro de estas funciones, as se compila
+  // entero con el conjunto de instrucciones de su palabra.
+  CRIPTO_TARGET("sse2") CRIPTO_FLATTEN static void
+  searchSSE2(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+    std::vector<uint64_t>& found)
+  {
+    Kernel<SSE2Ops>::search(plain, cipher, begin, end, found);
+  }
+
+  CRIPTO_TARGET("avx2") CRIPTO_FLATTEN static void
+  searchAVX2(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+    std::vector<uint64_t>& found)
+  {
+    Kernel<AVX2Ops>::search(plain, cipher, begin, end, found);
+  }
+#endif
+
+  static unsigned
+  lowestBit(uint64_t m) {
+    unsigned i = 0;
+    while (!(m & 1)) {
+      m >>= 1;
+      ++i;
+    }
+    return i;
+  }
+
+  // Posicin tras P de cada bit (1..32) de la salida de las cajas S.
+  static std::array<uint8_t, 33>
+  inversePermutationP() {
+    std::array<uint8_t, 33> inv{};
+    for (int i = 0; i < 32; ++i) inv[DESTables::P[i]] = static_cast<uint8_t>(i + 1);
+    return inv;
+  }
+
+  // --- Cajas S como suma de minitrminos ---
+  // Columnas (b2 b3 b4 b5) con el bit de salida a 1, para cada caja, fila
+  // (b1 b6) y bit de salida. Cada fila de una caja es una permutacin de
+  // 0..15, as que cada bit vale 1 en exactamente 8 columnas.
+  using ColumnLists = std::array<std::array<std::array<std::array<uint8_t, 8>, 4>, 4>, 8>;
+
+  static constexpr ColumnLists
+  columnLists() {
+    ColumnLists lists{};
+    for (int s = 0; s < 8; ++s) {
+      for (int row = 0; row < 4; ++row) {
+        for (int ob = 0; ob < 4; ++ob) {
+          int n = 0;
+          for (int col = 0; col < 16; ++col) {
+            if ((DESTables::SBOX[s][row * 16 + col] >> (3 - ob)) & 1) {
+              lists[s][row][ob][n++] = static_cast<uint8_t>(col);
+            }
+          }
+        }
+      }
+    }
+    return lists;
+  }
+
+  // --- Kernel, comn a todos los anchos de palabra ---
+  template <class Ops>
+  struct Kernel : Ops {
+    using Word = typename Ops::Word;
+    using Ops::andW;
+    using Ops::orW;
+    using Ops::xorW;
+    using Ops::andNotW;
+
+    static constexpr unsigned kWords64 = sizeof(Word) / sizeof(uint64_t);
+    static constexpr unsigned kWordLanes = 64 * kWords64;
+
+    static void
+    search(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+      std::vector<uint64_t>& found)
+    {
+      const uint64_t ip = DESTables::permute(plain, DESTables::IP, 64);
+      const uint64_t target = DESTables::permute(cipher, DESTables::IP, 64);
+      // Tras 16 rondas, IP(cipher) = R16 | L16 y L16 = R15.
+      const uint32_t wantR15 = static_cast<uint32_t>(target);
+      const uint32_t wantR16 = static_cast<uint32_t>(target >> 32);
+
+      Word L[33], R[33], K[65];
+      uint64_t lanes[kWords64];
+      uint64_t base = begin & ~uint64_t(kWordLanes - 1);
+      if (base >= end) return;
+      loadKeys(base, ~uint64_t(0), K);
+      for (uint64_t prev = base; base < end; prev = base, base += kWordLanes) {
+        // Entre lotes consecutivos solo cambian los bits altos que se acarrean
+        if (base != prev) loadKeys(base, base ^ prev, K);
+        for (unsigned i = 1; i <= 32; ++i) {
+          L[i] = constant(DESTables::bit(ip >> 32, i, 32));
+          R[i] = constant(DESTables::bit(ip, i, 32));
+        }
+
+        Word* l = L;
+        Word* r = R;
+        for (int round = 0; round < 15; ++round) {
+          feistelRound(round, l, r, K);
+          std::swap(l, r);
+        }
+        // Filtro temprano: R15 ya debe coincidir; casi nunca sobrevive alguna clave.
+        Word mismatch = differs(r, wantR15);
+        if (allOnes(mismatch)) continue;
+        feistelRound(15, l, r, K);
+        std::swap(l, r);
+        mismatch = orW(mismatch, differs(r, wantR16));
+        if (allOnes(mismatch)) continue;
+
+        store(lanes, mismatch);
+        for (unsigned w = 0; w < kWords64; ++w) {
+          for (uint64_t m = ~lanes[w]; m; m &= m - 1) {
+            uint64_t k = base + 64 * w + lowestBit(m);
+            if (k >= begin && k < end) found.push_back(k);
+          }
+        }
+      }
+    }
+
+    // --- Operaciones sobre palabras ---
+    static Word
+    load(const uint64_t* p) {
+      Word w;
+      std::memcpy(&w.v, p, sizeof(w.v));
+      return w;
+    }
+
+    static void
+    store(uint64_t* p, const Word& w) {
+      std::memcpy(p, &w.v, sizeof(w.v));
+    }
+
+    static Word
+    splat(uint64_t x) {
+      uint64_t tmp[kWords64];
+      for (auto& t : tmp) t = x;
+      return load(tmp);
+    }
+
+    static Word
+    constant(uint64_t bit) {
+      return splat(bit ? ~uint64_t(0) : 0);
+    }
+
+    static Word
+    notW(const Word& a) {
+      return xorW(a, constant(1));
+    }
+
+    static bool
+    allOnes(const Word& w) {
+      uint64_t tmp[kWords64];
+      store(tmp, w);
+      uint64_t acc = ~uint64_t(0);
+      for (uint64_t t : tmp) acc &= t;
+      return acc == ~uint64_t(0);
+    }
+
+    // --- Claves ---
+    // K[n] = bit n (1..64, norma) de la clave de cada carril. El carril i
+    // prueba el ndice base + i: los bits bajos del ndice varan entre
+    // carriles y los dems son constantes. Solo se escriben los bits del
+    // ndice marcados en 'bits'.
+    static void
+    loadKeys(uint64_t base, uint64_t bits, Word K[65]) {
+      static const uint64_t kPattern[6] = {
+        0xAAAAAAAAAAAAAAAAull, 0xCCCCCCCCCCCCCCCCull, 0xF0F0F0F0F0F0F0F0ull,
+        0xFF00FF00FF00FF00ull, 0xFFFF0000FFFF0000ull, 0xFFFFFFFF00000000ull };
+      for (unsigned j = 0; j < 56; ++j) {
+        if (!((bits >> j) & 1)) continue;
+        // Bit j del ndice -> bit (8 * (j / 7) + j % 7 + 1) de la clave de 64 bits
+        const unsigned pos = 8 * (j / 7) + j % 7 + 1;
+        Word w;
+        if (j < 6) {
+          w = splat(kPattern[j]);
+        }
+        else if ((uint64_t(1) << j) < kWordLanes) {
+          uint64_t tmp[kWords64];
+          for (unsigned c = 0; c < kWords64; ++c) tmp[c] = ((c >> (j - 6)) & 1) ? ~uint64_t(0) : 0;
+          w = load(tmp);
+        }
+        else {
+          w = constant((base >> j) & 1);
+        }
+        K[64 - pos] = w;
+      }
+    }
+
+    // --- Ronda ---
+    static Word
+    differs(const Word* x, uint32_t want) {
+      Word acc = constant(0);
+      for (unsigned i = 1; i <= 32; ++i) {
+        acc = orW(acc, DESTables::bit(want, i, 32) ? notW(x[i]) : x[i]);
+      }
+      return acc;
+    }
+
+    // l ^= f(r, subclave de la ronda). La salida de las cajas S se escribe
+    // directamente en su posicin tras la permutacin P.
+    static void
+    feistelRound(int round, Word* l, const Word* r, const Word* K) {
+      static constexpr auto kSubkey = DESTables::subkeyBits();
+      static const std::array<uint8_t, 33> kPInverse = inversePermutationP();
+      const uint8_t* sub = kSubkey[round].data();
+      roundBoxes(l, r, K, sub, kPInverse.data(), std::make_index_sequence<8>());
+    }
+
+    template <size_t... S>
+    static void
+    roundBoxes(Word* l, const Word* r, const Word* K, const uint8_t* sub,
+      const uint8_t* pinv, std::index_sequence<S...>)
+    {
+      (applyBox<S>(l, r, K, sub, pinv), ...);
+    }
+
+    template <size_t S>
+    static void
+    applyBox(Word* l, const Word* r, const Word* K, const uint8_t* sub, const uint8_t* pinv) {
+      Word x[6], out[4];
+      for (int k = 0; k < 6; ++k) {
+        x[k] = xorW(r[DESTables::E[6 * S + k]], K[sub[6 * S + k]]);
+      }
+      sbox<S>(x, out);
+      for (int k = 0; k < 4; ++k) {
+        Word& dst = l[pinv[4 * S + k + 1]];
+        dst = xorW(dst, out[k]);
+      }
+    }
+
+    template <size_t S>
+    static void
+    sbox(const Word x[6], Word out[4]) {
+      static constexpr ColumnLists kCols = columnLists();
+
+      // Minitrminos de pares de entradas: (b2 b3), (b4 b5) y la fila (b1 b6)
+      Word hi[4], lo[4], row[4];
+      pairTerms(x[1], x[2], hi);
+      pairTerms(x[3], x[4], lo);
+      pairTerms(x[0], x[5], row);
+
+      Word col[16];
+      for (int h = 0; h < 4; ++h) {
+        for (int j = 0; j < 4; ++j) col[h * 4 + j] = andW(hi[h], lo[j]);
+      }
+
+      for (int ob = 0; ob < 4; ++ob) {
+        Word acc = constant(0);
+        for (int rw = 0; rw < 4; ++rw) {
+          const auto& cols = kCols[S][rw][ob];
+          Word f = orW(orW(orW(col[cols[0]], col[cols[1]]), orW(col[cols[2]], col[cols[3]])),
+            orW(orW(col[cols[4]], col[cols[5]]), orW(col[cols[6]], col[cols[7]])));
+          acc = orW(acc, andW(row[rw], f));
+        }
+        out[ob] = acc;
+      }
+    }
+
+    // t[ab] = (a == bit alto de ab) & (b == bit bajo de ab)
+    static void
+    pairTerms(const Word& a, const Word& b, Word t[4]) {
+      t[0] = andNotW(a, notW(b));
+      t[1] = andNotW(a, b);
+      t[2] = andNotW(b, a);
+      t[3] = andW(a, b);
+    }
+  };
+};
@@ -0,0 +1,137 @@
+#pragma once
+#include "Prerequisites.h"
+#include "DESBitslice.h"
+#include "ThreadPool.h"
+
+/**
+ * @class DESKeySearch
+ * @brief Bsqueda paralela de claves DES con un bloque claro conocido.
+ *
+ * El espacio de ndices de 56 bits se divide en fragmentos de shardKeys
+ * claves que los hilos del pool toman a demanda, as todos los ncleos
+ * trabajan hasta el final aunque unos vayan ms rpido que otros. Cada
+ * fragmento se prueba con DESBitslice, que no tiene planificacin de claves
+ * y entre lotes consecutivos solo actualiza los bits de clave que cambian.
+ */
+class
+DESKeySearch {
+public:
+  struct Options {
+    unsigned threads = 0;        ///< 0 = hilos del hardware.
+    bool stopAtFirst = true;     ///< Termina en cuanto algn hilo encuentra una clave.
+    uint64_t shardKeys = 1 << 20;  ///< Claves por fragmento (mltiplo de DESBitslice::kLanes).
+    /// Cancelacin cooperativa: si otro hilo lo pone en true, la bsqueda
+    /// termina pronto y devuelve lo encontrado hasta ese momento.
+    const std::atomic<bool>* cancel = nullptr;
+    /// Avance (claves probadas, claves por segundo). Se llama desde el hilo
+    /// que inici la bsqueda, cada progressSeconds y una vez al final.
+    std::function<void(uint64_t keys, double keysPerSecond)> progress;
+    double progressSeconds = 1.0;
+  };
+
+  struct Result {
+    std::vector<uint64_t> keys;  ///< ndices de 56 bits, ordenados (ver DESBitslice::expandKey56).
+    uint64_t keysTested = 0;
+    bool completed = false;      ///< false si se detuvo antes de probarlas todas.
+  };
+
+  /**
+   * @brief Prueba los ndices de clave [begin, end) contra el par (plain, cipher).
+   *
+   * Con stopAtFirst los hilos terminan el fragmento en curso y se detienen,
+   * as que puede haber ms de una clave en el resultado (las equivalentes
+   * o las de fragmentos que ya estaban en marcha).
+   */
+  static Result
+  search(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+    const Options& options)
+  {
+    return run(plain, cipher, begin, end, options, nullptr);
+  }
+
+  static Result
+  search(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end)
+  {
+    return search(plain, cipher, begin, end, Options());
+  }
+
+  /// Igual que search(), pero reutiliza un pool existente (options.threads se ignora).
+  static Result
+  search(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+    const Options& options, ThreadPool& pool)
+  {
+    return run(plain, cipher, begin, end, options, &pool);
+  }
+
+private:
+  static Result
+  run(uint64_t plain, uint64_t cipher, uint64_t begin, uint64_t end,
+    const Options& options, ThreadPool* shared)
+  {
+    if (options.shardKeys == 0 || options.shardKeys % DESBitslice::kLanes != 0) {
+      throw std::invalid_argument("shardKeys debe ser mltiplo de DESBitslice::kLanes.");
+    }
+    if (end > kKeyspace) throw std::invalid_argument("ndice de clave fuera de 56 bits.");
+
+    Result result;
+    if (begin >= end) {
+      result.completed = true;
+      return result;
+    }
+
+    std::unique_ptr<ThreadPool> own;
+    if (!shared) own = std::make_unique<ThreadPool>(options.threads);
+    ThreadPool& pool = shared ? *shared : *own;
+
+    std::vector<std::vector<uint64_t>> found(pool.size());
+    std::atomic<uint64_t> tested{ 0 };
+    std::atomic<bool> stop{ false };
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto lastReport = start;
+    auto report = [&](Clock::time_point now) {
+      double secs = std::chrono::duration<double>(now - start).count();
+      uint64_t keys = tested.load(std::memory_order_relaxed);
+      options.progress(keys, secs > 0.0 ? double(keys) / secs : 0.0);
+      lastReport = now;
+    };
+
+    // Fragmentos alineados a shardKeys; el primero y el ltimo pueden ser parciales
+    const uint64_t first = begin / options.shardKeys;
+    const uint64_t shards = (end - 1) / options.shardKeys - first + 1;
+
+    pool.parallelFor(static_cast<size_t>(shards), 1, [&](unsigned id, size_t lo, size_t hi) {
+      for (size_t shard = lo; shard < hi; ++shard) {
+        if (stop.load(std::memory_order_relaxed)) return;
+        if (options.cancel && options.cancel->load(std::memory_order_relaxed)) {
+          stop.store(true);
+          return;
+        }
+
+        const uint64_t from = std::max(begin, (first + shard) * options.shardKeys);
+        const uint64_t to = std::min(end, (first + shard + 1) * options.shardKeys);
+        const size_t before = found[id].size();
+        DESBitslice::search(plain, cipher, from, to, found[id]);
+        tested.fetch_add(to - from, std::memory_order_relaxed);
+        if (options.stopAtFirst && found[id].size() != before) stop.store(true);
+
+        if (id == 0 && options.progress) {
+          auto now = Clock::now();
+          if (std::chrono::duration<double>(now - lastReport).count() >= options.progressSeconds) {
+            report(now);
+          }
+        }
+      }
+      });
+
+    for (const auto& f : found) result.keys.insert(result.keys.end(), f.begin(), f.end());
+    std::sort(result.keys.begin(), result.keys.end());
+    result.keysTested = tested.load();
+    result.completed = result.keysTested == end - begin;
+    if (options.progress) report(Clock::now());
+    return result;
+  }
+
+  static constexpr uint64_t kKeyspace = uint64_t(1) << 56;
+};
@@ -0,0 +1,262 @@
+#pragma once
+#include "Prerequisites.h"
+#include "DES.h"
+#include "DESBitslice.h"
+#include "MappedFile.h"
+#include "ThreadPool.h"
+
+/**
+ * @class DESRainbowTable
+ * @brief Tabla arcoris (compromiso tiempo-memoria) para recuperar la clave
+ *        DES de un bloque claro fijo a partir de su cifrado.
+ *
+ * Una cadena parte de un ndice de clave k0 y alterna cifrar el bloque
+ * claro con reducir el cifrado a otro ndice: k(i+1) = R_i(E_k(i)(P)), con
+ * una reduccin distinta por columna. Solo se guardan el inicio y el final
+ * de cada cadena, ordenadas por el final. Buscar un cifrado cuesta unas
+ * t/2 operaciones DES (t = largo de cadena) en lugar de recorrer todo el
+ * espacio de claves.
+ *
+ * Las claves son ndices de 56 bits (ver DESBitslice::expandKey56) en un
+ * espacio reducido de keyBits bits. Una tabla con chains  chainLength
+ * cercano a 2^keyBits cubre entre el 60 y el 80 % de las claves; varias
+ * tablas con distinta salt cubren casi todo.
+ *
+ * Formato (enteros little-endian); se lee proyectado con MappedFile:
+ *   cabecera : "DESRAINB" | versin u32 | keyBits u32 | chainLength u32 |
+ *              reservado u32 | plain u64 | salt u64 | count u64
+ *   cadenas  : count registros end u64 | start u64, ordenados por end y
+ *              sin finales repetidos
+ */
+class
+DESRainbowTable {
+public:
+  struct Params {
+    unsigned keyBits = 32;             ///< ndices de clave en [0, 2^keyBits).
+    uint32_t chainLength = 4096;       ///< Claves por cadena (t).
+    uint64_t chains = uint64_t(1) << 20;  ///< Cadenas a generar (m).
+    uint64_t plain = 0;                ///< Bloque claro conocido.
+    uint64_t salt = 0;                 ///< Distingue tablas: cambia las reducciones.
+    unsigned threads = 0;              ///< 0 = hilos del hardware.
+  };
+
+  struct LookupResult {
+    bool found = false;
+    uint64_t key = 0;          ///< ndice de 56 bits (si found).
+    uint64_t chainWalks = 0;   ///< Cadenas reconstruidas desde su inicio.
+    uint64_t falseAlarms = 0;  ///< Finales que coincidieron sin contener la clave.
+  };
+
+  /**
+   * @brief Genera las cadenas en paralelo y escribe la tabla en 'path'.
+   * @return Cadenas guardadas (las que terminan igual que otra se descartan).
+   */
+  static uint64_t
+  generate(const std::string& path, const Params& params) {
+    validate(params.keyBits, params.chainLength);
+    if (params.chains == 0 || params.chains > (uint64_t(1) << params.keyBits)) {
+      throw std::invalid_argument("chains debe estar entre 1 y 2^keyBits.");
+    }
+    const Chain chain{ params.plain, params.salt, mask(params.keyBits) };
+
+    ThreadPool pool(params.threads);
+    std::vector<Record> records(static_cast<size_t>(params.chains));
+    pool.parallelFor(records.size(), kChainGrain, [&](unsigned, size_t begin, size_t end) {
+      DES des;
+      for (size_t i = begin; i < end; ++i) {
+        records[i] = { chain.walk(des, i, 0, params.chainLength), i };
+      }
+      });
+
+    std::sort(records.begin(), records.end(), [](const Record& a, const Record& b) {
+      return a.end != b.end ? a.end < b.end : a.start < b.start;
+      });
+    records.erase(std::unique(records.begin(), records.end(),
+      [](const Record& a, const Record& b) { return a.end == b.end; }), records.end());
+
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) throw std::runtime_error("No se pudo crear: " + path);
+    unsigned char header[kHeaderSize] = {};
+    std::memcpy(header, kMagic, 8);
+    putLE(header + 8, kVersion, 4);
+    putLE(header + 12, params.keyBits, 4);
+    putLE(header + 16, params.chainLength, 4);
+    putLE(header + 24, params.plain, 8);
+    putLE(header + 32, params.salt, 8);
+    putLE(header + 40, records.size(), 8);
+    out.write(reinterpret_cast<const char*>(header), kHeaderSize);
+
+    std::vector<unsigned char> buf;
+    buf.reserve(kWriteChunk * kRecordSize);
+    for (size_t i = 0; i < records.size(); ++i) {
+      unsigned char rec[kRecordSize];
+      putLE(rec, records[i].end, 8);
+      putLE(rec + 8, records[i].start, 8);
+      buf.insert(buf.end(), rec, rec + kRecordSize);
+      if (buf.size() == kWriteChunk * kRecordSize || i + 1 == records.size()) {
+        out.write(reinterpret_cast<const char*>(buf.data()), static_cast<std::streamsize>(buf.size()));
+        buf.clear();
+      }
+    }
+    if (!out) throw std::runtime_error("No se pudo escribir: " + path);
+    return records.size();
+  }
+
+  /**
+   * @brief Proyecta una tabla generada con generate().
+   * @throws std::runtime_error Si el archivo no es una tabla vlida.
+   */
+  explicit DESRainbowTable(const std::string& path) : m_file(path) {
+    const unsigned char* d = m_file.data();
+    if (m_file.size() < kHeaderSize || std::memcmp(d, kMagic, 8) != 0
+      || getLE(d + 8, 4) != kVersion) {
+      throw std::runtime_error("No es una tabla arcoris DES: " + path);
+    }
+    m_keyBits = static_cast<unsigned>(getLE(d + 12, 4));
+    m_chainLength = static_cast<uint32_t>(getLE(d + 16, 4));
+    m_chain = { getLE(d + 24, 8), getLE(d + 32, 8), 0 };
+    m_count = getLE(d + 40, 8);
+    validate(m_keyBits, m_chainLength);
+    m_chain.mask = mask(m_keyBits);
+    // Sin multiplicar m_count: un valor manipulado podra desbordar
+    if ((m_file.size() - kHeaderSize) % kRecordSize != 0
+      || m_count != (m_file.size() - kHeaderSize) / kRecordSize) {
+      throw std::runtime_error("Tabla arcoris truncada: " + path);
+    }
+  }
+
+  unsigned keyBits() const { return m_keyBits; }
+  uint32_t chainLength() const { return m_chainLength; }
+  uint64_t chains() const { return m_count; }
+  uint64_t plain() const { return m_chain.plain; }
+
+  /**
+   * @brief Busca la clave que cifra plain() en 'cipher'.
+   *
+   * Prueba en paralelo cada columna donde podra estar la clave: desde ah
+   * completa la cadena hasta el final y, si ese final est en la tabla,
+   * la rehace desde su inicio para confirmar. Usa el pool compartido, as
+   * las bsquedas repetidas no crean ni destruyen hilos.
+   */
+  LookupResult
+  lookup(uint64_t cipher, ThreadPool& pool = ThreadPool::shared()) const {
+    std::atomic<bool> done{ false };
+    std::atomic<uint64_t> walks{ 0 }, alarms{ 0 };
+    std::mutex mtx;
+    LookupResult result;
+
+    // Columnas ms cercanas al final primero: son las ms baratas
+    pool.parallelFor(m_chainLength, 1, [&](unsigned, size_t begin, size_t end) {
+      DES des;
+      for (size_t c = begin; c < end && !done.load(std::memory_order_relaxed); ++c) {
+        const uint32_t col = m_chainLength - 1 - static_cast<uint32_t>(c);
+        const uint64_t tail = m_chain.walk(des, m_chain.reduce(cipher, col), col + 1, m_chainLength);
+        for (size_t i = findEnd(tail); i < m_count && recordEnd(i) == tail; ++i) {
+          walks.fetch_add(1, std::memory_order_relaxed);
+          const uint64_t key = m_chain.walk(des, recordStart(i), 0, col);
+          des.setKey(std::bitset<64>(DESBitslice::expandKey56(key)));
+          if (des.encodeBlock(m_chain.plain) != cipher) {
+            alarms.fetch_add(1, std::memory_order_relaxed);
+            continue;
+          }
+          std::lock_guard<std::mutex> lock(mtx);
+          if (!result.found) {
+            result.found = true;
+            result.key = key;
+          }
+          done.store(true);
+        }
+      }
+      });
+
+    result.chainWalks = walks.load();
+    result.falseAlarms = alarms.load();
+    return result;
+  }
+
+private:
+  struct Record {
+    uint64_t end;
+    uint64_t start;
+  };
+
+  // Paso de cadena: cifrar P con la clave y reducir el cifrado a un ndice
+  struct Chain {
+    uint64_t plain;
+    uint64_t salt;
+    uint64_t mask;
+
+    uint64_t
+    reduce(uint64_t cipher, uint32_t column) const {
+      return ((cipher ^ salt) + column) & mask;
+    }
+
+    /// Avanza la clave k de la columna 'from' a la columna 'to'.
+    uint64_t
+    walk(DES& des, uint64_t k, uint32_t from, uint32_t to) const {
+      for (uint32_t col = from; col < to; ++col) {
+        des.setKey(std::bitset<64>(DESBitslice::expandKey56(k)));
+        k = reduce(des.encodeBlock(plain), col);
+      }
+      return k;
+    }
+  };
+
+  static constexpr const char* kMagic = "DESRAINB";
+  static constexpr uint32_t kVersion = 1;
+  static constexpr size_t kHeaderSize = 48;
+  static constexpr size_t kRecordSize = 16;
+  static constexpr size_t kChainGrain = 256;     ///< Cadenas por bloque de trabajo.
+  static constexpr size_t kWriteChunk = 1 << 16; ///< Registros por escritura.
+
+  MappedFile m_file;
+  unsigned m_keyBits = 0;
+  uint32_t m_chainLength = 0;
+  uint64_t m_count = 0;
+  Chain m_chain{ 0, 0, 0 };
+
+  static void
+  validate(unsigned keyBits, uint32_t chainLength) {
+    if (keyBits < 8 || keyBits > 56) throw std::invalid_argument("keyBits debe estar entre 8 y 56.");
+    if (chainLength == 0) throw std::invalid_argument("chainLength debe ser mayor que cero.");
+  }
+
+  static uint64_t
+  mask(unsigned keyBits) {
+    return (uint64_t(1) << keyBits) - 1;
+  }
+
+  uint64_t
+  recordEnd(uint64_t i) const {
+    return getLE(m_file.data() + kHeaderSize + i * kRecordSize, 8);
+  }
+
+  uint64_t
+  recordStart(uint64_t i) const {
+    return getLE(m_file.data() + kHeaderSize + i * kRecordSize + 8, 8);
+  }
+
+  // Primer registro con end >= value (bsqueda binaria sobre la proyeccin)
+  uint64_t
+  findEnd(uint64_t value) const {
+    uint64_t lo = 0, hi = m_count;
+    while (lo < hi) {
+      uint64_t mid = lo + (hi - lo) / 2;
+      if (recordEnd(mid) < value) lo = mid + 1;
+      else hi = mid;
+    }
+    return lo;
+  }
+
+  static void
+  putLE(unsigned char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<unsigned char>(v >> (8 * i));
+  }
+
+  static uint64_t
+  getLE(const unsigned char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = 0; i < bytes; ++i) v |= uint64_t(p[i]) << (8 * i);
+    return v;
+  }
+};
@@ -0,0 +1,385 @@
+#pragma once
+#include "Prerequisites.h"
+#include "DES.h"
+#include "DESBitslice.h"
+#include "ThreadPool.h"
+
+/**
+ * @class DoubleDESAttack
+ * @brief Ataque de encuentro a medio camino contra doble DES,
+ *        C = E_k2(E_k1(P)).
+ *
+ * Cifra P con cada k1 y guarda (E_k1(P), k1) en una tabla ordenada por el
+ * valor intermedio; despus descifra C con cada k2 y busca D_k2(C) en la
+ * tabla. Cuesta unas 2  2^n operaciones DES en lugar de 2^(2n): el doble
+ * cifrado apenas aade un bit de seguridad.
+ *
+ * Las claves se recorren por su ndice de 56 bits (ver
+ * DESBitslice::expandKey56) en un espacio reducido de keyBits bits. Si la
+ * tabla no cabe en memoryLimit, ambos lados se reparten por los bits altos
+ * del valor intermedio en cubetas en disco y se cruzan cubeta a cubeta.
+ * Las cubetas de cada lado comparten un solo archivo, dentro de un
+ * directorio propio de la ejecucin que se borra al terminar.
+ */
+class
+DoubleDESAttack {
+public:
+  /// Par (claro, cifrado) conocido; bloques big-endian.
+  struct KnownPair {
+    uint64_t plain = 0;
+    uint64_t cipher = 0;
+  };
+
+  struct Options {
+    unsigned threads = 0;            ///< 0 = hilos del hardware.
+    unsigned keyBits = 20;           ///< k1 y k2 en [0, 2^keyBits).
+    size_t memoryLimit = size_t(1) << 30;  ///< Bytes para la tabla en memoria (o los bferes de cubeta).
+    std::string spillDir;            ///< Dnde crear las cubetas; vaco = directorio temporal.
+    /// Parte de k2 que se prueba: [probeBegin, probeEnd), 0 = hasta el final.
+    /// Permite repartir una bsqueda grande entre varias mquinas.
+    uint64_t probeBegin = 0;
+    uint64_t probeEnd = 0;
+  };
+
+  struct KeyPair {
+    uint64_t k1 = 0;  ///< ndice de 56 bits de la primera clave.
+    uint64_t k2 = 0;  ///< ndice de 56 bits de la segunda clave.
+  };
+
+  struct Result {
+    std::vector<KeyPair> keys;   ///< Pares que cumplen todos los pares conocidos.
+    uint64_t tableEntries = 0;
+    uint64_t probes = 0;
+    uint64_t collisions = 0;     ///< Coincidencias del primer par antes de verificar.
+    unsigned buckets = 1;        ///< 1 = todo en memoria.
+    uint64_t bucketBytes = 0;    ///< Memoria estimada por cubeta (tabla + sondeos).
+  };
+
+  /**
+   * @param pairs Pares conocidos. El primero construye la tabla; los dems
+   *              descartan las coincidencias casuales (con keyBits bits por
+   *              clave se espera 2^(2keyBits - 64) falsas por par).
+   * @throws std::invalid_argument Si no hay ningn par.
+   */
+  explicit DoubleDESAttack(std::vector<KnownPair> pairs) : m_pairs(std::move(pairs)) {
+    if (m_pairs.empty()) throw std::invalid_argument("Se necesita al menos un par conocido.");
+  }
+
+  /// E_k2(E_k1(plain)) con claves dadas por su ndice de 56 bits.
+  static uint64_t
+  encrypt(uint64_t k1, uint64_t k2, uint64_t plain) {
+    DES a(std::bitset<64>(DESBitslice::expandKey56(k1)));
+    DES b(std::bitset<64>(DESBitslice::expandKey56(k2)));
+    return b.encodeBlock(a.encodeBlock(plain));
+  }
+
+  /**
+   * @throws std::invalid_argument Si keyBits est fuera de rango.
+   * @throws std::runtime_error Si ni con el mximo de cubetas (4096) cada
+   *         una cabe en memoryLimit; el mensaje indica cunta necesita.
+   */
+  Result
+  run(const Options& options) const {
+    if (options.keyBits == 0 || options.keyBits > 40) {
+      throw std::invalid_argument("keyBits debe estar entre 1 y 40.");
+    }
+    const uint64_t keys = uint64_t(1) << options.keyBits;
+    const uint64_t probeEnd = options.probeEnd == 0 ? keys : std::min(options.probeEnd, keys);
+    const uint64_t probeBegin = std::min(options.probeBegin, probeEnd);
+
+    ThreadPool pool(options.threads);
+    Result result;
+    result.tableEntries = keys;
+    result.probes = probeEnd - probeBegin;
+
+    // Cubetas: potencia de dos tal que cada una quepa en memoryLimit. Con
+    // cubetas, cada una tiene a la vez su tabla y los sondeos de su lado.
+    unsigned bucketBits = 0;
+    if (tableBytes(keys) > options.memoryLimit) {
+      bucketBits = 1;
+      while (bucketBits < kMaxBucketBits
+        && tableBytes(keys >> bucketBits) + (result.probes >> bucketBits) * sizeof(Entry)
+        > options.memoryLimit) ++bucketBits;
+    }
+    result.buckets = 1u << bucketBits;
+    result.bucketBytes = bucketBits == 0 ? tableBytes(keys)
+      : tableBytes(keys >> bucketBits) + (result.probes >> bucketBits) * sizeof(Entry);
+    if (result.bucketBytes > options.memoryLimit) {
+      throw std::runtime_error("Con " + std::to_string(result.buckets)
+        + " cubetas cada una necesita unos " + std::to_string(result.bucketBytes)
+        + " bytes y memoryLimit es " + std::to_string(options.memoryLimit)
+        + ": aumente memoryLimit o reduzca keyBits o el rango de sondeo.");
+    }
+
+    std::vector<std::vector<KeyPair>> found(pool.size());
+    std::atomic<uint64_t> collisions{ 0 };
+    if (bucketBits == 0) {
+      std::vector<Entry> entries(keys);
+      forEachKey(pool, 0, keys, true, [&](unsigned, uint64_t k, uint64_t mid) {
+        entries[k] = { mid, k };
+        });
+      const Table table = buildTable(pool, std::move(entries), 0);
+      forEachKey(pool, probeBegin, probeEnd, false, [&](unsigned id, uint64_t k2, uint64_t mid) {
+        probe(table, mid, k2, found[id], collisions);
+        });
+    }
+    else {
+      const SpillDir dir(options.spillDir.empty()
+        ? fs::temp_directory_path() : fs::path(options.spillDir));
+      SpillFile forward(dir.path() / "fwd.bin", result.buckets);
+      SpillFile backward(dir.path() / "bwd.bin", result.buckets);
+      const size_t run = spillRunEntries(options.memoryLimit, pool.size(), result.buckets);
+      spill(pool, 0, keys, true, bucketBits, run, forward);
+      spill(pool, probeBegin, probeEnd, false, bucketBits, run, backward);
+
+      // Cubeta a cubeta: cargar y ordenar la tabla, cargar y sondear el otro lado
+      for (unsigned b = 0; b < result.buckets; ++b) {
+        const Table table = buildTable(pool, forward.load(b), bucketBits);
+        const std::vector<Entry> probes = backward.load(b);
+        pool.parallelFor(probes.size(), kProbeGrain, [&](unsigned id, size_t begin, size_t end) {
+          for (size_t i = begin; i < end; ++i) probe(table, probes[i].mid, probes[i].key, found[id], collisions);
+          });
+      }
+    }
+
+    for (const auto& f : found) result.keys.insert(result.keys.end(), f.begin(), f.end());
+    std::sort(result.keys.begin(), result.keys.end(), [](const KeyPair& a, const KeyPair& b) {
+      return a.k1 != b.k1 ? a.k1 < b.k1 : a.k2 < b.k2;
+      });
+    result.collisions = collisions.load();
+    return result;
+  }
+
+private:
+  struct Entry {
+    uint64_t mid;  ///< E_k1(P) o D_k2(C).
+    uint64_t key;  ///< ndice de 56 bits.
+  };
+
+  // Entradas ordenadas por mid y un directorio por los bits de mid que
+  // siguen a los de la cubeta: las de prefijo p estn en
+  // [start[p], start[p + 1]). Como los valores intermedios son uniformes,
+  // cada sondeo mira una o dos entradas en lugar de una bsqueda binaria
+  // por toda la tabla.
+  struct Table {
+    std::vector<Entry> entries;
+    std::vector<size_t> start;
+    unsigned shift = 0;
+    uint64_t mask = 0;
+  };
+
+  static constexpr unsigned kMaxBucketBits = 12;     ///< Hasta 4096 cubetas.
+  static constexpr size_t kKeyGrain = 1 << 14;       ///< Claves por bloque de trabajo.
+  static constexpr size_t kProbeGrain = 1 << 14;
+  static constexpr size_t kSortGrain = 1 << 12;      ///< Partes del directorio por bloque de trabajo.
+  static constexpr unsigned kMaxDirectoryBits = 24;
+  static constexpr size_t kSpillBuffer = 4096;       ///< Mximo de entradas por bfer de cubeta y hilo.
+  static constexpr size_t kMinSpillRun = 64;         ///< Mnimo, aunque se pase de memoryLimit.
+
+  std::vector<KnownPair> m_pairs;
+
+  // fn(hilo, k, E_k(P0)) o fn(hilo, k, D_k(C0)) para k en [begin, end)
+  template <typename Fn>
+  void
+  forEachKey(ThreadPool& pool, uint64_t begin, uint64_t end, bool forward, Fn&& fn) const {
+    const KnownPair& first = m_pairs.front();
+    pool.parallelFor(static_cast<size_t>(end - begin), kKeyGrain, [&](unsigned id, size_t lo, size_t hi) {
+      DES des;
+      for (size_t i = lo; i < hi; ++i) {
+        const uint64_t k = begin + i;
+        des.setKey(std::bitset<64>(DESBitslice::expandKey56(k)));
+        fn(id, k, forward ? des.encodeBlock(first.plain) : des.decodeBlock(first.cipher));
+      }
+      });
+  }
+
+  // Bits del directorio: unas dos entradas por parte.
+  static unsigned
+  directoryBits(uint64_t entries) {
+    unsigned dirBits = 1;
+    while (dirBits < kMaxDirectoryBits && (uint64_t(2) << dirBits) < entries) ++dirBits;
+    return dirBits;
+  }
+
+  // Memoria de buildTable con n entradas: las entradas, el directorio y
+  // los cursores que usa mientras reparte.
+  static uint64_t
+  tableBytes(uint64_t n) {
+    const uint64_t parts = uint64_t(1) << directoryBits(n);
+    return n * sizeof(Entry) + (2 * parts + 1) * sizeof(size_t);
+  }
+
+  static Table
+  buildTable(ThreadPool& pool, std::vector<Entry> entries, unsigned bucketBits) {
+    const unsigned dirBits = directoryBits(entries.size());
+    Table t;
+    t.shift = 64 - bucketBits - dirBits;
+    t.mask = (uint64_t(1) << dirBits) - 1;
+    t.start.assign((size_t(1) << dirBits) + 1, 0);
+    t.entries = std::move(entries);
+    auto partOf = [&](const Entry& e) { return static_cast<size_t>((e.mid >> t.shift) & t.mask); };
+
+    // Reparto por prefijo en sitio (cada entrada va por ciclos a su parte,
+    // sin una segunda copia de la tabla) y orden de cada parte en paralelo
+    for (const Entry& e : t.entries) ++t.start[partOf(e) + 1];
+    for (size_t i = 1; i < t.start.size(); ++i) t.start[i] += t.start[i - 1];
+    std::vector<size_t> next(t.start.begin(), t.start.end() - 1);
+    for (size_t p = 0; p < next.size(); ++p) {
+      while (next[p] < t.start[p + 1]) {
+        Entry e = t.entries[next[p]];
+        for (size_t q = partOf(e); q != p; q = partOf(e)) std::swap(e, t.entries[next[q]++]);
+        t.entries[next[p]++] = e;
+      }
+    }
+    pool.parallelFor(t.start.size() - 1, kSortGrain, [&](unsigned, size_t lo, size_t hi) {
+      for (size_t part = lo; part < hi; ++part) {
+        std::sort(t.entries.begin() + t.start[part], t.entries.begin() + t.start[part + 1],
+          [](const Entry& a, const Entry& b) { return a.mid < b.mid; });
+      }
+      });
+    return t;
+  }
+
+  void
+  probe(const Table& table, uint64_t mid, uint64_t k2,
+    std::vector<KeyPair>& found, std::atomic<uint64_t>& collisions) const
+  {
+    const size_t part = (mid >> table.shift) & table.mask;
+    for (size_t i = table.start[part]; i < table.start[part + 1]; ++i) {
+      const Entry& e = table.entries[i];
+      if (e.mid > mid) break;
+      if (e.mid < mid) continue;
+      collisions.fetch_add(1, std::memory_order_relaxed);
+      if (verify(e.key, k2)) found.push_back({ e.key, k2 });
+    }
+  }
+
+  bool
+  verify(uint64_t k1, uint64_t k2) const {
+    DES a(std::bitset<64>(DESBitslice::expandKey56(k1)));
+    DES b(std::bitset<64>(DESBitslice::expandKey56(k2)));
+    for (size_t i = 1; i < m_pairs.size(); ++i) {
+      if (b.encodeBlock(a.encodeBlock(m_pairs[i].plain)) != m_pairs[i].cipher) return false;
+    }
+    return true;
+  }
+
+  // --- Cubetas en disco ---
+  // Directorio nico por ejecucin, para que dos ataques simultneos no
+  // compartan cubetas. Se borra con su contenido al destruirse, tambin
+  // si el ataque termina con una excepcin.
+  class SpillDir {
+  public:
+    explicit SpillDir(const fs::path& base) {
+      fs::create_directories(base);
+      std::random_device rd;
+      for (int attempt = 0; attempt < 16; ++attempt) {
+        std::ostringstream name;
+        name << "doubledes-" << std::hex << rd() << rd();
+        if (fs::create_directory(base / name.str())) {
+          m_path = base / name.str();
+          return;
+        }
+      }
+      throw std::runtime_error("No se pudo crear un directorio en: " + base.string());
+    }
+
+    ~SpillDir() {
+      std::error_code ec;
+      fs::remove_all(m_path, ec);
+    }
+
+    SpillDir(const SpillDir&) = delete;
+    SpillDir& operator=(const SpillDir&) = delete;
+
+    const fs::path&
+    path() const {
+      return m_path;
+    }
+
+  private:
+    fs::path m_path;
+  };
+
+  // Todas las cubetas de un lado en un solo archivo: cada bfer vaciado se
+  // escribe como un tramo contiguo y se anota en la lista de su cubeta.
+  // As hay dos archivos abiertos sea cual sea el nmero de cubetas.
+  class SpillFile {
+  public:
+    SpillFile(const fs::path& path, unsigned buckets) : m_path(path.string()), m_runs(buckets) {
+      m_file.open(m_path, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+      if (!m_file) throw std::runtime_error("No se pudo crear: " + m_path);
+    }
+
+    void
+    append(unsigned bucket, const std::vector<Entry>& entries) {
+      if (entries.empty()) return;
+      std::lock_guard<std::mutex> lock(m_mtx);
+      m_file.seekp(static_cast<std::streamoff>(m_size * sizeof(Entry)));
+      m_file.write(reinterpret_cast<const char*>(entries.data()),
+        static_cast<std::streamsize>(entries.size() * sizeof(Entry)));
+      if (!m_file) throw std::runtime_error("No se pudo escribir: " + m_path);
+      m_runs[bucket].push_back({ m_size, entries.size() });
+      m_size += entries.size();
+    }
+
+    std::vector<Entry>
+    load(unsigned bucket) {
+      std::lock_guard<std::mutex> lock(m_mtx);
+      size_t total = 0;
+      for (const Run& r : m_runs[bucket]) total += r.count;
+      std::vector<Entry> entries(total);
+      Entry* dst = entries.data();
+      for (const Run& r : m_runs[bucket]) {
+        m_file.seekg(static_cast<std::streamoff>(r.first * sizeof(Entry)));
+        m_file.read(reinterpret_cast<char*>(dst), static_cast<std::streamsize>(r.count * sizeof(Entry)));
+        dst += r.count;
+      }
+      if (!m_file) throw std::runtime_error("No se pudo leer: " + m_path);
+      return entries;
+    }
+
+  private:
+    struct Run {
+      uint64_t first;  ///< Primera entrada del tramo en el archivo.
+      size_t count;
+    };
+
+    std::string m_path;
+    std::fstream m_file;
+    std::mutex m_mtx;
+    uint64_t m_size = 0;                 ///< Entradas escritas.
+    std::vector<std::vector<Run>> m_runs;
+  };
+
+  // Entradas por bfer de cubeta y hilo: todos los bferes juntos caben en
+  // memoryLimit, entre kMinSpillRun y kSpillBuffer.
+  static size_t
+  spillRunEntries(size_t memoryLimit, unsigned threads, unsigned buckets) {
+    const size_t perBuffer = memoryLimit / (size_t(threads) * buckets * sizeof(Entry));
+    return std::min(kSpillBuffer, std::max(kMinSpillRun, perBuffer));
+  }
+
+  void
+  spill(ThreadPool& pool, uint64_t begin, uint64_t end, bool forward,
+    unsigned bucketBits, size_t runEntries, SpillFile& file) const
+  {
+    const unsigned buckets = 1u << bucketBits;
+    // Bferes por hilo y cubeta; se vacan al llenarse y al terminar
+    std::vector<std::vector<std::vector<Entry>>> buffers(pool.size(),
+      std::vector<std::vector<Entry>>(buckets));
+    forEachKey(pool, begin, end, forward, [&](unsigned id, uint64_t k, uint64_t mid) {
+      const unsigned b = static_cast<unsigned>(mid >> (64 - bucketBits));
+      auto& buf = buffers[id][b];
+      if (buf.capacity() == 0) buf.reserve(runEntries);
+      buf.push_back({ mid, k });
+      if (buf.size() == runEntries) {
+        file.append(b, buf);
+        buf.clear();
+      }
+      });
+    for (auto& perThread : buffers) {
+      for (unsigned b = 0; b < buckets; ++b) file.append(b, perThread[b]);
+    }
+  }
+};
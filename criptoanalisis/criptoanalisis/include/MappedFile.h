@@ -0,0 +1,152 @@
+#pragma once
+#include "Prerequisites.h"
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class MappedFile
+ * @brief Proyeccin de un archivo en memoria, de solo lectura.
+ *
+ * Permite recorrer archivos de varios GB sin copiarlos: el sistema operativo
+ * carga las pginas bajo demanda y las comparte entre hilos. Un archivo
+ * vaco se abre sin proyeccin y data() devuelve nullptr.
+ */
+class
+MappedFile {
+public:
+  MappedFile() = default;
+
+  /**
+   * @brief Proyecta el archivo completo.
+   * @throws std::runtime_error Si no se puede abrir o proyectar.
+   */
+  explicit MappedFile(const std::string& path) {
+    open(path);
+  }
+
+  ~MappedFile() {
+    close();
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept {
+    *this = std::move(other);
+  }
+
+  MappedFile&
+  operator=(MappedFile&& other) noexcept {
+    if (this != &other) {
+      close();
+      std::swap(m_data, other.m_data);
+      std::swap(m_size, other.m_size);
+#if defined(_WIN32)
+      std::swap(m_file, other.m_file);
+      std::swap(m_mapping, other.m_mapping);
+#endif
+    }
+    return *this;
+  }
+
+  void
+  open(const std::string& path) {
+    close();
+#if defined(_WIN32)
+    m_file = CreateFileW(fs::path(path).c_str(), GENERIC_READ, FILE_SHARE_READ,
+      nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_file == INVALID_HANDLE_VALUE) {
+      throw std::runtime_error("No se pudo abrir: " + path);
+    }
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(m_file, &size)) {
+      close();
+      throw std::runtime_error("No se pudo obtener el tamao de: " + path);
+    }
+    m_size = static_cast<size_t>(size.QuadPart);
+    if (m_size == 0) return;
+    m_mapping = CreateFileMappingW(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!m_mapping) {
+      close();
+      throw std::runtime_error("No se pudo proyectar: " + path);
+    }
+    m_data = static_cast<const unsigned char*>(
+      MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!m_data) {
+      close();
+      throw std::runtime_error("No se pudo proyectar: " + path);
+    }
+#else
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) throw std::runtime_error("No se pudo abrir: " + path);
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      ::close(fd);
+      throw std::runtime_error("No se pudo obtener el tamao de: " + path);
+    }
+    m_size = static_cast<size_t>(st.st_size);
+    if (m_size > 0) {
+      void* p = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+      if (p == MAP_FAILED) {
+        ::close(fd);
+        m_size = 0;
+        throw std::runtime_error("No se pudo proyectar: " + path);
+      }
+      madvise(p, m_size, MADV_SEQUENTIAL);
+      m_data = static_cast<const unsigned char*>(p);
+    }
+    ::close(fd);  // la proyeccin sigue vlida sin el descriptor
+#endif
+  }
+
+  void
+  close() {
+#if defined(_WIN32)
+    if (m_data) UnmapViewOfFile(m_data);
+    if (m_mapping) CloseHandle(m_mapping);
+    if (m_file != INVALID_HANDLE_VALUE) CloseHandle(m_file);
+    m_mapping = nullptr;
+    m_file = INVALID_HANDLE_VALUE;
+#else
+    if (m_data) munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+  }
+
+  const unsigned char*
+  data() const {
+    return m_data;
+  }
+
+  size_t
+  size() const {
+    return m_size;
+  }
+
+  bool
+  empty() const {
+    return m_size == 0;
+  }
+
+private:
+  const unsigned char* m_data = nullptr;
+  size_t m_size = 0;
+#if defined(_WIN32)
+  HANDLE m_file = INVALID_HANDLE_VALUE;
+  HANDLE m_mapping = nullptr;
+#endif
+};
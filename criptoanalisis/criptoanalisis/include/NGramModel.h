@@ -0,0 +1,192 @@
+#pragma once
+#include "Prerequisites.h"
+
+/**
+ * @class NGramModel
+ * @brief Modelo de n-gramas de letras (A..Z) para puntuar texto descifrado.
+ *
+ * Guarda log-probabilidades en tablas planas: unigramas log P(a), bigramas
+ * log P(b | a) y cuadrigramas log P(d | a b c). Un texto se punta
+ * sumando trminos independientes por posicin, as que la suma puede
+ * calcularse por partes (por ejemplo, por columna de una clave Vigenre)
+ * y actualizarse solo donde cambi algo.
+ *
+ * spanish() entrena el modelo con un corpus pequeo incluido en el cdigo;
+ * para mejores resultados se puede entrenar con un corpus propio.
+ */
+class
+NGramModel {
+public:
+  /// Entrena con las letras del corpus (se ignoran maysculas y el resto).
+  explicit NGramModel(const std::string& corpus) {
+    std::vector<unsigned char> letters;
+    for (unsigned char c : corpus) {
+      if (c >= 'A' && c <= 'Z') letters.push_back(static_cast<unsigned char>(c - 'A'));
+      else if (c >= 'a' && c <= 'z') letters.push_back(static_cast<unsigned char>(c - 'a'));
+    }
+    if (letters.size() < 2) throw std::invalid_argument("Corpus demasiado corto.");
+
+    std::array<double, 26> uni{};
+    std::vector<double> bi(26 * 26, 0.0), tri(26 * 26 * 26, 0.0), quad(kQuadgrams, 0.0);
+    for (size_t i = 0; i < letters.size(); ++i) {
+      size_t idx = letters[i];
+      uni[idx] += 1.0;
+      if (i < 1) continue;
+      idx += letters[i - 1] * 26;
+      bi[idx] += 1.0;
+      if (i < 2) continue;
+      idx += letters[i - 2] * 26 * 26;
+      tri[idx] += 1.0;
+      if (i < 3) continue;
+      quad[idx + letters[i - 3] * 26 * 26 * 26] += 1.0;
+    }
+
+    // Unigramas con suavizado de Laplace; bigramas interpolados con los
+    // unigramas para que ningn par tenga probabilidad cero.
+    std::array<double, 26> p1;
+    for (int a = 0; a < 26; ++a) {
+      p1[a] = (uni[a] + 1.0) / (double(letters.size()) + 26.0);
+      m_uni[a] = static_cast<float>(std::log(p1[a]));
+    }
+    for (int a = 0; a < 26; ++a) {
+      double row = 0.0;
+      for (int b = 0; b < 26; ++b) row += bi[a * 26 + b];
+      for (int b = 0; b < 26; ++b) {
+        double ml = row > 0.0 ? bi[a * 26 + b] / row : 0.0;
+        m_bi[a * 26 + b] = static_cast<float>(std::log(kLambda * ml + (1.0 - kLambda) * p1[b]));
+      }
+    }
+
+    // Cuadrigramas: cada orden se suaviza hacia el anterior,
+    // P(d | ctx) = (c(ctx d) + k  P(d | ctx ms corto)) / (c(ctx) + k),
+    // as un contexto nunca visto hereda la prediccin del ms corto.
+    std::vector<double> p2(26 * 26), p3(26 * 26 * 26);
+    for (size_t cd = 0; cd < p2.size(); ++cd) {
+      p2[cd] = (bi[cd] + kBackoff * p1[cd % 26]) / (uni[cd / 26] + kBackoff);
+    }
+    for (size_t bcd = 0; bcd < p3.size(); ++bcd) {
+      p3[bcd] = (tri[bcd] + kBackoff * p2[bcd % (26 * 26)]) / (bi[bcd / 26] + kBackoff);
+    }
+    m_quad.resize(kQuadgrams);
+    for (size_t abcd = 0; abcd < kQuadgrams; ++abcd) {
+      double p4 = (quad[abcd] + kBackoff * p3[abcd % (26 * 26 * 26)]) / (tri[abcd / 26] + kBackoff);
+      m_quad[abcd] = static_cast<float>(std::log(p4));
+    }
+  }
+
+  /// Modelo del espaol, entrenado una sola vez con el corpus incluido.
+  static const NGramModel&
+  spanish() {
+    static const NGramModel model(spanishCorpus());
+    return model;
+  }
+
+  /// log P(a), con a en 0..25.
+  float
+  unigram(unsigned a) const {
+    return m_uni[a];
+  }
+
+  /// log P(b | a), con a y b en 0..25.
+  float
+  bigram(unsigned a, unsigned b) const {
+    return m_bi[a * 26 + b];
+  }
+
+  /// Tabla plana de bigramas: [a * 26 + b].
+  const float*
+  bigrams() const {
+    return m_bi.data();
+  }
+
+  /// Nmero de entradas de la tabla de cuadrigramas (26^4).
+  static constexpr size_t kQuadgrams = 26 * 26 * 26 * 26;
+
+  /// ndice de cuadrigrama: ((a * 26 + b) * 26 + c) * 26 + d.
+  static size_t
+  quadIndex(unsigned a, unsigned b, unsigned c, unsigned d) {
+    return ((a * 26 + b) * 26 + c) * 26 + d;
+  }
+
+  /// Tabla plana de cuadrigramas: log P(d | a b c) en [quadIndex(a, b, c, d)].
+  const float*
+  quadgrams() const {
+    return m_quad.data();
+  }
+
+  /// Suma de log P(d | a b c) sobre todas las ventanas de 4 letras 0..25.
+  double
+  quadgramScore(const unsigned char* letters, size_t n) const {
+    double sum = 0.0;
+    for (size_t i = 3; i < n; ++i) {
+      sum += m_quad[quadIndex(letters[i - 3], letters[i - 2], letters[i - 1], letters[i])];
+    }
+    return sum;
+  }
+
+  /// Log-verosimilitud de una secuencia de letras 0..25.
+  double
+  score(const unsigned char* letters, size_t n) const {
+    if (n == 0) return 0.0;
+    double sum = m_uni[letters[0]];
+    for (size_t i = 1; i < n; ++i) sum += m_bi[letters[i - 1] * 26 + letters[i]];
+    return sum;
+  }
+
+private:
+  static constexpr double kLambda = 0.9;   ///< Peso del bigrama observado frente al unigrama.
+  static constexpr double kBackoff = 2.0;  ///< Peso del orden inferior en los cuadrigramas.
+
+  std::array<float, 26> m_uni{};
+  std::array<float, 26 * 26> m_bi{};
+  std::vector<float> m_quad;  ///< 26^4 floats (1.8 MB).
+
+  static const char*
+  spanishCorpus() {
+    return
+      "La criptografia es tan antigua como la escritura. Los generales de Roma enviaban "
+      "ordenes a sus tropas desplazando cada letra del alfabeto algunas posiciones, y durante "
+      "siglos ese sencillo metodo bastaba para proteger los mensajes de los ojos curiosos. "
+      "Con el tiempo los reyes y los comerciantes necesitaron sistemas mas seguros, porque "
+      "sus enemigos aprendieron a contar cuantas veces aparecia cada letra y a comparar esas "
+      "cuentas con las del idioma en que estaba escrito el texto original. "
+      "En el siglo dieciseis se popularizo el cifrado que hoy conocemos con el nombre de "
+      "Vigenere. En lugar de usar un solo desplazamiento, el autor elegia una palabra clave y "
+      "cada letra de esa palabra indicaba cuanto habia que mover la letra correspondiente del "
+      "mensaje. Durante casi trescientos anos se penso que nadie podria romperlo, y por eso "
+      "lo llamaban la cifra indescifrable. Sin embargo, un oficial prusiano observo que las "
+      "mismas palabras cifradas con la misma parte de la clave producian grupos de letras "
+      "repetidos, y que la distancia entre esos grupos revelaba la longitud de la clave. "
+      "Una vez conocida esa longitud, el problema se reduce a resolver varios cifrados de "
+      "desplazamiento simple, uno por cada columna del texto. "
+      "La ciudad despertaba temprano aquel dia de otono. Los vendedores del mercado colocaban "
+      "las frutas sobre las mesas de madera mientras los primeros clientes buscaban los "
+      "mejores precios. En la plaza principal, frente a la iglesia, un grupo de ninos jugaba "
+      "con una pelota vieja y los abuelos conversaban sentados en los bancos a la sombra de "
+      "los arboles. Nadie parecia tener prisa, aunque todos sabian que por la tarde llegaria "
+      "la lluvia y que habria que recoger todo antes de que empezara la tormenta. "
+      "Mi hermana trabaja como profesora en una escuela del barrio. Cada manana prepara sus "
+      "clases con cuidado, porque dice que los alumnos notan enseguida cuando el maestro no "
+      "sabe lo que quiere ensenar. Le gusta explicar la historia de su pais a traves de las "
+      "vidas de las personas comunes, de los campesinos, de los obreros y de las mujeres que "
+      "sostuvieron a sus familias en tiempos dificiles. Sus estudiantes la quieren mucho y "
+      "muchos de ellos vuelven a visitarla cuando ya son adultos. "
+      "Los ordenadores modernos pueden probar millones de claves por segundo, de modo que la "
+      "seguridad de un sistema ya no depende de ocultar el metodo sino de que el numero de "
+      "claves posibles sea tan grande que ninguna maquina pueda recorrerlo entero. Por esa "
+      "razon los algoritmos actuales usan claves de cientos de bits y se publican para que "
+      "cualquier experto pueda estudiarlos y buscar sus debilidades. Un buen cifrado es aquel "
+      "que sigue siendo seguro aunque el enemigo conozca todos los detalles de su diseno, "
+      "excepto la clave. "
+      "El viaje en tren desde la capital hasta la costa dura unas seis horas. Por la ventana "
+      "se ven campos de trigo, pueblos blancos con sus torres de piedra y, al final, el mar "
+      "azul que aparece de repente detras de una colina. Muchas familias hacen ese recorrido "
+      "cada verano para pasar unas semanas junto a la playa, lejos del calor y del ruido de "
+      "la gran ciudad. Al llegar, lo primero que hacen es caminar por la arena y mojarse los "
+      "pies en el agua fria, como si quisieran comprobar que el mar sigue en su sitio. "
+      "Para escribir un buen informe conviene empezar por las conclusiones y despues explicar "
+      "como se llego a ellas. Los lectores tienen poco tiempo y necesitan saber desde el "
+      "principio que es lo importante. Las tablas y los graficos ayudan, pero no sustituyen "
+      "a una explicacion clara escrita con frases cortas y palabras sencillas.";
+  }
+};
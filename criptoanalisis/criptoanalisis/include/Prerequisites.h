@@ -15,6 +15,17 @@
 #include <array>
 #include <fstream>
 #include <filesystem>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <limits>
+#include <thread>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <chrono>
+#include <memory>
+#include <optional>
 
 namespace fs = std::filesystem;
 
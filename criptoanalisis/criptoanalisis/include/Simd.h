@@ -0,0 +1,116 @@
+#pragma once
+#include "Prerequisites.h"
+
+// --- Deteccin de arquitectura e intrnsecos ---
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CRIPTO_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+// Permite compilar una sola funcin con un conjunto de instrucciones extra
+// (p. ej. AVX2) sin exigirlo al resto del programa. MSVC no lo necesita:
+// acepta los intrnsecos en cualquier funcin.
+#if defined(CRIPTO_X86) && !defined(_MSC_VER)
+#define CRIPTO_TARGET(isa) __attribute__((target(isa)))
+#else
+#define CRIPTO_TARGET(isa)
+#endif
+
+// Inlinea en la funcin todas sus llamadas, recursivamente. Junto con
+// CRIPTO_TARGET compila un kernel genrico entero con esas instrucciones.
+#if defined(__GNUC__) || defined(__clang__)
+#define CRIPTO_FLATTEN __attribute__((flatten))
+#else
+#define CRIPTO_FLATTEN
+#endif
+
+/**
+ * @class Simd
+ * @brief Consulta, una sola vez, qu extensiones SIMD soporta la CPU.
+ *
+ * Los kernels vectorizados eligen su camino en tiempo de ejecucin con
+ * estas funciones y siempre conservan una versin escalar de respaldo.
+ */
+class
+Simd {
+public:
+  static bool
+  hasSSE2() {
+    return features().sse2;
+  }
+
+  static bool
+  hasSSSE3() {
+    return features().ssse3;
+  }
+
+  static bool
+  hasAVX2() {
+    return features().avx2;
+  }
+
+private:
+  struct Features {
+    bool sse2 = false;
+    bool ssse3 = false;
+    bool avx2 = false;
+  };
+
+  static const Features&
+  features() {
+    static const Features f = detect();
+    return f;
+  }
+
+  static Features
+  detect() {
+    Features f;
+#if defined(CRIPTO_X86)
+    unsigned int r1[4] = {}, r7[4] = {};
+    unsigned int maxLeaf = cpuid(0, r1);
+    cpuid(1, r1);
+    f.sse2 = (r1[3] >> 26) & 1;
+    f.ssse3 = (r1[2] >> 9) & 1;
+
+    // AVX2 requiere adems que el sistema operativo guarde los registros YMM.
+    bool osxsave = (r1[2] >> 27) & 1;
+    bool avx = (r1[2] >> 28) & 1;
+    if (maxLeaf >= 7 && osxsave && avx && (xgetbv0() & 0x6) == 0x6) {
+      cpuid(7, r7);
+      f.avx2 = (r7[1] >> 5) & 1;
+    }
+#endif
+    return f;
+  }
+
+#if defined(CRIPTO_X86)
+  // Devuelve EAX y llena regs = {EAX, EBX, ECX, EDX} para la hoja dada.
+  static unsigned int
+  cpuid(unsigned int leaf, unsigned int regs[4]) {
+#if defined(_MSC_VER)
+    int r[4];
+    __cpuidex(r, static_cast<int>(leaf), 0);
+    for (int i = 0; i < 4; ++i) regs[i] = static_cast<unsigned int>(r[i]);
+#else
+    __cpuid_count(leaf, 0, regs[0], regs[1], regs[2], regs[3]);
+#endif
+    return regs[0];
+  }
+
+  static unsigned long long
+  xgetbv0() {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    unsigned int eax = 0, edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<unsigned long long>(edx) << 32) | eax;
+#endif
+  }
+#endif
+};
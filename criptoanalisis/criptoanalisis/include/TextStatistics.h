@@ -0,0 +1,196 @@
+#pragma once
+#include "Prerequisites.h"
+
+/**
+ * @class TextStatistics
+ * @brief Frecuencias de referencia y medidas estadsticas sobre texto.
+ *
+ * Rene las tablas de frecuencia de letras del espaol y del ingls y las
+ * medidas que usan los ataques estadsticos del proyecto (chi-cuadrado,
+ * ndice de coincidencia y puntaje por byte de texto plano).
+ */
+class
+TextStatistics {
+public:
+  enum class Language { Spanish, English };
+
+  /// Frecuencia relativa (suma 1) de cada letra A..Z en el idioma dado.
+  static const std::array<double, 26>&
+  letterFrequencies(Language lang) {
+    static const std::array<double, 26> spanish = normalize({
+      11.525, 2.215, 4.019, 5.010, 12.181, 0.692, 1.768, 0.703, 6.247,
+      0.493, 0.011, 4.967, 3.157, 6.712, 8.683, 2.510, 0.877, 6.871,
+      7.977, 4.632, 2.927, 1.138, 0.017, 0.215, 1.008, 0.467 });
+    static const std::array<double, 26> english = normalize({
+      8.167, 1.492, 2.782, 4.253, 12.702, 2.228, 2.015, 6.094, 6.966,
+      0.153, 0.772, 4.025, 2.406, 6.749, 7.507, 1.929, 0.095, 5.987,
+      6.327, 9.056, 2.758, 0.978, 2.360, 0.150, 1.974, 0.074 });
+    return lang == Language::Spanish ? spanish : english;
+  }
+
+  /**
+   * @brief Estadstico chi-cuadrado de unas cuentas de letras frente a un idioma.
+   *
+   * @param counts Cuentas de A..Z ya rotadas al desplazamiento que se evala.
+   * @param total  Suma de counts.
+   * @return Valor chi-cuadrado; menor significa ms parecido al idioma.
+   */
+  static double
+  chiSquared(const uint64_t counts[26], uint64_t total, Language lang) {
+    if (total == 0) return 0.0;
+    const auto& expected = letterFrequencies(lang);
+    double chi = 0.0;
+    for (int i = 0; i < 26; ++i) {
+      double e = expected[i] * double(total);
+      double d = double(counts[i]) - e;
+      chi += d * d / e;
+    }
+    return chi;
+  }
+
+  /**
+   * @brief ndice de coincidencia de un histograma.
+   *
+   * Probabilidad de que dos smbolos tomados al azar sean iguales. Para
+   * bytes uniformes vale 1/256; para texto en espaol o ingls ronda 0.06
+   * sobre letras. Es invariante ante cualquier sustitucin monoalfabtica.
+   */
+  static double
+  indexOfCoincidence(const uint64_t* counts, size_t symbols, uint64_t total) {
+    if (total < 2) return 0.0;
+    double sum = 0.0;
+    for (size_t i = 0; i < symbols; ++i) {
+      sum += double(counts[i]) * double(counts[i] - (counts[i] > 0));
+    }
+    return sum / (double(total) * double(total - 1));
+  }
+
+  /**
+   * @brief Log-probabilidad de cada byte en texto plano (espaol o ingls).
+   *
+   * Modelo de unigramas de bytes: espacio, letras segn la media de ambos
+   * idiomas, dgitos y puntuacin poco frecuentes, bytes de control casi
+   * imposibles. Sumar la tabla sobre un texto da su log-verosimilitud.
+   */
+  static const std::array<double, 256>&
+  byteLogProbabilities() {
+    static const std::array<double, 256> table = buildByteTable();
+    return table;
+  }
+
+  /**
+   * @brief Histograma de bytes en una sola pasada.
+   *
+   * Usa cuatro sub-histogramas intercalados: bytes repetidos seguidos caen
+   * en contadores distintos y no se encadenan escrituras y lecturas sobre
+   * la misma posicin de memoria. Al final se suman en 'hist'.
+   */
+  static void
+  byteHistogram(const unsigned char* data, size_t n, std::array<uint64_t, 256>& hist) {
+    // 4 KiB en la pila: se llama una vez por mensaje en BatchCipher.
+    uint32_t sub[4][256] = {};
+    uint32_t* h0 = sub[0];
+    uint32_t* h1 = sub[1];
+    uint32_t* h2 = sub[2];
+    uint32_t* h3 = sub[3];
+    hist.fill(0);
+
+    // Los contadores de 32 bits se vuelcan antes de poder desbordarse.
+    const size_t block = size_t(1) << 30;
+    for (size_t start = 0; start < n; start += block) {
+      const size_t end = std::min(n, start + block);
+      size_t i = start;
+      for (; i + 4 <= end; i += 4) {
+        ++h0[data[i]];
+        ++h1[data[i + 1]];
+        ++h2[data[i + 2]];
+        ++h3[data[i + 3]];
+      }
+      for (; i < end; ++i) ++h0[data[i]];
+      for (int b = 0; b < 256; ++b) {
+        hist[b] += uint64_t(h0[b]) + h1[b] + h2[b] + h3[b];
+        h0[b] = h1[b] = h2[b] = h3[b] = 0;
+      }
+    }
+  }
+
+  /// Suma maysculas y minsculas de un histograma de bytes en counts[26]
+  /// y devuelve el total de letras.
+  static uint64_t
+  letterCounts(const std::array<uint64_t, 256>& hist, uint64_t counts[26]) {
+    uint64_t total = 0;
+    for (int i = 0; i < 26; ++i) {
+      counts[i] = hist['A' + i] + hist['a' + i];
+      total += counts[i];
+    }
+    return total;
+  }
+
+  /**
+   * @brief Tabla de bytes que cuentan como texto legible.
+   *
+   * ASCII imprimible (0x20..0x7E) y espacios en blanco (\t \n \v \f \r):
+   * lo mismo que isprint || isspace en la configuracin regional "C", pero
+   * con una consulta a tabla en lugar de una llamada a <cctype> por byte.
+   */
+  static const std::array<bool, 256>&
+  readableBytes() {
+    static const std::array<bool, 256> table = buildReadableTable();
+    return table;
+  }
+
+  /// Log-probabilidad media por byte; sirve para ordenar candidatos.
+  static double
+  meanLogProbability(const unsigned char* data, size_t n) {
+    if (n == 0) return 0.0;
+    const auto& logp = byteLogProbabilities();
+    double sum = 0.0;
+    for (size_t i = 0; i < n; ++i) sum += logp[data[i]];
+    return sum / double(n);
+  }
+
+private:
+  static std::array<double, 26>
+  normalize(std::array<double, 26> f) {
+    double sum = 0.0;
+    for (double v : f) sum += v;
+    for (double& v : f) v /= sum;
+    return f;
+  }
+
+  static std::array<bool, 256>
+  buildReadableTable() {
+    std::array<bool, 256> t{};
+    for (int c = 0x20; c < 0x7F; ++c) t[c] = true;
+    for (int c = 0x09; c <= 0x0D; ++c) t[c] = true;
+    return t;
+  }
+
+  static std::array<double, 256>
+  buildByteTable() {
+    std::array<double, 256> p;
+    p.fill(1e-7);  // control y bytes invlidos
+    for (int c = 0x80; c < 0x100; ++c) p[c] = 2e-4;  // acentos en Latin-1/UTF-8
+    for (int c = 0x21; c < 0x7F; ++c) p[c] = 1e-3;   // puntuacin y smbolos
+    for (int c = '0'; c <= '9'; ++c) p[c] = 2e-3;
+    p[' '] = 0.16;
+    p['\n'] = 0.01;
+    p['\r'] = 0.005;
+    p['\t'] = 0.001;
+    p['.'] = p[','] = 0.01;
+
+    const auto& es = letterFrequencies(Language::Spanish);
+    const auto& en = letterFrequencies(Language::English);
+    const double letters = 0.75;
+    for (int i = 0; i < 26; ++i) {
+      double f = letters * 0.5 * (es[i] + en[i]);
+      p['a' + i] = 0.95 * f;
+      p['A' + i] = 0.05 * f;
+    }
+
+    double sum = 0.0;
+    for (double v : p) sum += v;
+    for (double& v : p) v = std::log(v / sum);
+    return p;
+  }
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include "Prerequisites.h"
+
+/**
+ * @class ThreadPool
+ * @brief Pool de hilos persistente para repartir rangos de trabajo.
+ *
+ * parallelFor divide el rango [0, count) en bloques de tamao 'grain'. Cada
+ * hilo toma el siguiente bloque libre de un contador atmico, as los hilos
+ * que terminan antes se llevan el trabajo pendiente de los ms lentos y la
+ * carga se equilibra sola. El hilo que llama tambin trabaja (ndice 0).
+ */
+class
+ThreadPool {
+public:
+  /// Firma del trabajo: ndice del hilo en [0, size()) y sub-rango [begin, end).
+  using RangeFn = std::function<void(unsigned worker, size_t begin, size_t end)>;
+
+  /**
+   * @brief Crea el pool.
+   * @param threads Nmero total de hilos (0 = ncleos disponibles).
+   */
+  explicit ThreadPool(unsigned threads = 0) {
+    if (threads == 0) {
+      threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < threads; ++i) {
+      m_workers.emplace_back([this, i] { workerLoop(i); });
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> lock(m_mtx);
+      m_stopping = true;
+    }
+    m_wakeCv.notify_all();
+    for (auto& t : m_workers) t.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  /// Nmero de hilos que participan en cada parallelFor (incluye al llamador).
+  unsigned
+  size() const {
+    return static_cast<unsigned>(m_workers.size()) + 1;
+  }
+
+  /**
+   * @brief Ejecuta fn sobre [0, count) repartido en bloques de 'grain'.
+   *
+   * Bloquea hasta que todos los bloques terminan. Si algn bloque lanza una
+   * excepcin, los dems dejan de tomar trabajo y se relanza la primera.
+   * Una llamada anidada desde un trabajo de este mismo pool se ejecuta en
+   * serie con el ndice del hilo que la hace; desde un trabajo de otro pool
+   * se reparte normalmente y el llamador usa el ndice 0 de este pool.
+   */
+  void
+  parallelFor(size_t count, size_t grain, const RangeFn& fn) {
+    if (count == 0) return;
+    if (grain == 0) grain = 1;
+
+    const bool nested = t_owner == this;
+    if (nested || m_workers.empty()) {
+      for (size_t b = 0; b < count; b += grain) {
+        fn(nested ? t_workerIndex : 0, b, std::min(b + grain, count));
+      }
+      return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMtx);
+    {
+      std::lock_guard<std::mutex> lock(m_mtx);
+      m_job = &fn;
+      m_count = count;
+      m_grain = grain;
+      m_next.store(0);
+      m_error = nullptr;
+      m_pending = m_workers.size();
+      ++m_generation;
+    }
+    m_wakeCv.notify_all();
+
+    runChunks(0);
+
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_doneCv.wait(lock, [this] { return m_pending == 0; });
+    m_job = nullptr;
+    if (m_error) std::rethrow_exception(m_error);
+  }
+
+  /// Pool compartido por todo el programa, creado en el primer uso.
+  static ThreadPool&
+  shared() {
+    static ThreadPool pool;
+    return pool;
+  }
+
+private:
+  std::vector<std::thread> m_workers;
+  std::mutex m_mtx;                       ///< Protege el estado del trabajo actual.
+  std::mutex m_runMtx;                    ///< Serializa llamadas concurrentes a parallelFor.
+  std::condition_variable m_wakeCv;
+  std::condition_variable m_doneCv;
+  const RangeFn* m_job = nullptr;
+  size_t m_count = 0;
+  size_t m_grain = 1;
+  std::atomic<size_t> m_next{ 0 };
+  size_t m_pending = 0;
+  uint64_t m_generation = 0;
+  bool m_stopping = false;
+  std::exception_ptr m_error;
+
+  // Pool cuyo trabajo ejecuta este hilo y su ndice en l. Los thread_local
+  // son comunes a todas las instancias, as que el ndice solo vale para
+  // t_owner.
+  static inline thread_local const ThreadPool* t_owner = nullptr;
+  static inline thread_local unsigned t_workerIndex = 0;
+
+  void
+  runChunks(unsigned worker) {
+    const ThreadPool* outerOwner = t_owner;
+    const unsigned outerIndex = t_workerIndex;
+    t_owner = this;
+    t_workerIndex = worker;
+    try {
+      for (;;) {
+        size_t begin = m_next.fetch_add(m_grain);
+        if (begin >= m_count) break;
+        (*m_job)(worker, begin, std::min(begin + m_grain, m_count));
+      }
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(m_mtx);
+      if (!m_error) m_error = std::current_exception();
+      m_next.store(m_count);
+    }
+    t_owner = outerOwner;
+    t_workerIndex = outerIndex;
+  }
+
+  void
+  workerLoop(unsigned id) {
+    uint64_t seen = 0;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(m_mtx);
+        m_wakeCv.wait(lock, [&] { return m_stopping || m_generation != seen; });
+        if (m_stopping) return;
+        seen = m_generation;
+      }
+      runChunks(id);
+      {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        if (--m_pending == 0) m_doneCv.notify_one();
+      }
+    }
+  }
+};
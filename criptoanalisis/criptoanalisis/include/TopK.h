@@ -0,0 +1,96 @@
+#pragma once
+#include "Prerequisites.h"
+
+/**
+ * @class TopK
+ * @brief Conserva solo los K candidatos de mayor puntaje.
+ *
+ * Internamente es un min-heap de tamao fijo: la raz es el peor de los
+ * candidatos guardados, as decidir si un candidato nuevo entra cuesta una
+ * comparacin. Cada hilo puede llenar su propio TopK y unirlos al final
+ * con merge().
+ */
+template <typename T>
+class
+TopK {
+public:
+  struct Entry {
+    double score;
+    T value;
+  };
+
+  explicit TopK(size_t capacity = 1) : m_capacity(capacity) {
+    m_heap.reserve(capacity);
+  }
+
+  size_t
+  capacity() const {
+    return m_capacity;
+  }
+
+  size_t
+  size() const {
+    return m_heap.size();
+  }
+
+  bool
+  empty() const {
+    return m_heap.empty();
+  }
+
+  /// Puntaje mnimo que debe superar un candidato para entrar.
+  double
+  threshold() const {
+    return m_heap.size() < m_capacity
+      ? -std::numeric_limits<double>::infinity()
+      : m_heap.front().score;
+  }
+
+  bool
+  wouldAccept(double score) const {
+    return m_capacity > 0 && (m_heap.size() < m_capacity || score > m_heap.front().score);
+  }
+
+  /// Inserta el candidato si est entre los K mejores. Devuelve true si entr.
+  bool
+  push(double score, T value) {
+    if (!wouldAccept(score)) return false;
+    if (m_heap.size() == m_capacity) {
+      std::pop_heap(m_heap.begin(), m_heap.end(), worse);
+      m_heap.back() = Entry{ score, std::move(value) };
+    }
+    else {
+      m_heap.push_back(Entry{ score, std::move(value) });
+    }
+    std::push_heap(m_heap.begin(), m_heap.end(), worse);
+    return true;
+  }
+
+  void
+  merge(const TopK& other) {
+    for (const auto& e : other.m_heap) push(e.score, e.value);
+  }
+
+  void
+  clear() {
+    m_heap.clear();
+  }
+
+  /// Copia de los candidatos ordenados de mejor a peor.
+  std::vector<Entry>
+  sorted() const {
+    std::vector<Entry> out(m_heap.begin(), m_heap.end());
+    std::stable_sort(out.begin(), out.end(),
+      [](const Entry& a, const Entry& b) { return a.score > b.score; });
+    return out;
+  }
+
+private:
+  size_t m_capacity;
+  std::vector<Entry> m_heap;
+
+  static bool
+  worse(const Entry& a, const Entry& b) {
+    return a.score > b.score;
+  }
+};
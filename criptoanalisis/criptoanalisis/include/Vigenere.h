@@ -1,13 +1,23 @@
 #pragma once
 #include "Prerequisites.h"
+#include "AhoCorasick.h"
+#include "NGramModel.h"
+#include "Simd.h"
+#include "TextStatistics.h"
+#include "ThreadPool.h"
+#include "TopK.h"
 
 
 class Vigenere {
 public:
+  /// Smbolos que se cifran y consumen clave. Con Alnum los dgitos tambin
+  /// se desplazan, por la letra de clave mdulo 10; el resto no cambia.
+  enum class Alphabet { Letters, Alnum };
+
   Vigenere() = default;
 
-  Vigenere(const std::string& rawKey)
-    : key(normalizeKey(rawKey))
+  Vigenere(const std::string& rawKey, Alphabet alphabet = Alphabet::Letters)
+    : key(normalizeKey(rawKey)), alphabet(alphabet)
   {
     if (key.empty()) {
       throw std::invalid_argument("La clave no puede estar vaca o sin letras.");
@@ -37,6 +47,17 @@ public:
     return transform(text, /*encode=*/false);
   }
 
+  // --- Sobre buffers ya reservados (n bytes en 'out'), sin reservar memoria ---
+  void 
+  encodeInto(const char* in, size_t n, char* out) const {
+    transformInto(in, n, out, /*encode=*/true);
+  }
+
+  void 
+  decodeInto(const char* in, size_t n, char* out) const {
+    transformInto(in, n, out, /*encode=*/false);
+  }
+
   // --- I/O de archivos ---
   void 
   encryptFile(const std::string& inputPath,
@@ -56,112 +77,844 @@ public:
     writeFile(outputPath, plain);
   }
 
-  // --- Fuerza bruta para texto en memoria ---
-  // Devuelve la mejor clave encontrada hasta maxKeyLength
+  // --- Ataque estadstico (Kasiski + ndice de coincidencia) ---
+  // Recupera claves de hasta maxKeyLength letras sin bsqueda exhaustiva:
+  //  1) estima la longitud con el ndice de coincidencia de las columnas
+  //     (Friedman) y las distancias entre trigramas repetidos (Kasiski);
+  //  2) resuelve cada letra de la clave por separado con chi-cuadrado.
+  // Cuesta O(n  maxKeyLength) en lugar de 26^L descifrados completos.
+  // Devuelve una cadena vaca si el texto no tiene letras suficientes.
   static std::string 
-  breakEncode(const std::string& text,
-    int maxKeyLength)
+  breakStatistical(const std::string& text,
+    size_t maxKeyLength = 128)
   {
+    std::vector<unsigned char> letters = letterIndices(text);
+    const size_t maxLen = std::min(maxKeyLength, letters.size() / kMinColumnLetters);
+    if (maxLen == 0) return std::string();
+
+    // 1) Longitud: la menor cuyas columnas tienen un IC cercano al mximo
+    //    (Friedman). Los divisores de la longitud real mezclan varios
+    //    desplazamientos y bajan hacia el IC aleatorio (1/26); los mltiplos
+    //    igualan a la real pero son ms largos.
+    std::vector<double> ioc(maxLen + 1, 0.0);
+    double maxIoc = 0.0;
+    for (size_t L = 1; L <= maxLen; ++L) {
+      ioc[L] = columnCoincidence(letters, L);
+      maxIoc = std::max(maxIoc, ioc[L]);
+    }
+    size_t bestLen = 0;
+    if (maxIoc >= kLanguageIoc) {
+      for (size_t L = 1; L <= maxLen && bestLen == 0; ++L) {
+        if (ioc[L] >= kIocRatio * maxIoc) bestLen = L;
+      }
+    }
+    else {
+      // Texto poco natural: sin una longitud clara, manda Kasiski si
+      // encontr repeticiones; si no, el IC ms alto.
+      bestLen = kasiskiLength(letters, maxLen);
+      if (bestLen == 0) {
+        bestLen = static_cast<size_t>(std::max_element(ioc.begin() + 1, ioc.end()) - ioc.begin());
+      }
+    }
+
+    // 2) Cada letra de la clave por separado
+    return minimalPeriod(solveColumns(letters, bestLen));
+  }
+
+  // Rompe el archivo con breakStatistical, guarda el texto descifrado en
+  // outputPath y devuelve la clave.
+  static std::string 
+  breakStatisticalFile(const std::string& inputPath,
+    const std::string& outputPath,
+    size_t maxKeyLength = 128)
+  {
+    std::string cipher = readFileStatic(inputPath);
+    std::string k = breakStatistical(cipher, maxKeyLength);
+    if (k.empty()) {
+      throw std::runtime_error("Texto insuficiente para estimar la clave: " + inputPath);
+    }
+    Vigenere v(k);
+    std::ofstream out(outputPath, std::ios::binary);
+    if (!out) throw std::runtime_error("No se pudo escribir: " + outputPath);
+    out << v.decode(cipher);
+
+    std::cout << "Clave recuperada (" << k.size() << " letras): " << k << "\n"
+      << "Guardado: " << outputPath << "\n";
+    return k;
+  }
+
+  // --- Solver estocstico (recocido simulado con cuadrigramas) ---
+  struct AnnealOptions {
+    unsigned threads = 0;     ///< 0 = hilos del hardware.
+    size_t keyLength = 0;     ///< 0 = probar las longitudes con mejor IC.
+    size_t restarts = 8;      ///< Arranques independientes por longitud.
+    size_t iterations = 0;    ///< Pasos por arranque; 0 = automtico segn la longitud.
+    double temperature = 2.0; ///< Temperatura inicial; 0 = ascenso de colina puro.
+    uint64_t seed = 0;        ///< Semilla para resultados reproducibles; 0 = aleatoria.
+  };
+
+  /**
+   * @brief Recupera claves largas en textos cortos con recocido simulado.
+   *
+   * Cada arranque parte de una clave aleatoria (el primero, de la solucin
+   * por chi-cuadrado de cada columna), cambia una letra al azar y acepta el
+   * cambio segn la diferencia de puntaje de cuadrigramas y la temperatura,
+   * que baja hasta cero; al final se pule letra por letra. Al cambiar una
+   * letra solo se vuelven a puntuar las ventanas que tocan su columna.
+   *
+   * Los arranques se reparten entre los hilos; cada uno tiene su propio
+   * generador sembrado con (seed, longitud, arranque), as que con una
+   * semilla fija el resultado no depende del nmero de hilos.
+   *
+   * Entre longitudes gana la de mayor puntaje menos Lln(26), el costo de
+   * describir la clave: los mltiplos de la longitud real no ganan solo por
+   * tener ms letras libres.
+   */
+  static std::string 
+  breakAnnealing(const std::string& text,
+    size_t maxKeyLength = 64)
+  {
+    return breakAnnealing(text, maxKeyLength, AnnealOptions());
+  }
+
+  static std::string 
+  breakAnnealing(const std::string& text,
+    size_t maxKeyLength,
+    const AnnealOptions& options)
+  {
+    std::vector<unsigned char> letters = letterIndices(text);
+    if (letters.size() < 4) return std::string();
+    const uint64_t seed = options.seed ? options.seed : std::random_device{}();
+
+    // Longitudes a probar: la pedida o las de mayor IC de columna
+    std::vector<size_t> lengths;
+    if (options.keyLength) {
+      lengths.push_back(options.keyLength);
+    }
+    else {
+      const size_t maxLen = std::min(maxKeyLength, letters.size() / kAnnealMinColumn);
+      std::vector<std::pair<double, size_t>> byIoc;
+      for (size_t L = 1; L <= maxLen; ++L) byIoc.push_back({ columnCoincidence(letters, L), L });
+      std::stable_sort(byIoc.begin(), byIoc.end(),
+        [](const auto& a, const auto& b) { return a.first > b.first; });
+      for (size_t i = 0; i < std::min(kAnnealLengths, byIoc.size()); ++i) {
+        lengths.push_back(byIoc[i].second);
+      }
+    }
+
+    ThreadPool pool(options.threads);
+    std::string bestKey;
     double bestScore = -std::numeric_limits<double>::infinity();
-    std::string bestKey, trailKey, bestPlain;
-
-    auto dfs = [&](auto&& self, int pos, int len) -> void {
-      if (pos == len) {
-        Vigenere v(trailKey);
-        std::string candidate = v.decode(text);
-        double score = fitness(candidate);
-        if (score > bestScore) {
-          bestScore = score;
-          bestKey = trailKey;
-          bestPlain = candidate;
+    for (size_t L : lengths) {
+      std::vector<double> scores(options.restarts);
+      std::vector<std::string> keys(options.restarts);
+      pool.parallelFor(options.restarts, 1, [&](unsigned, size_t begin, size_t end) {
+        for (size_t r = begin; r < end; ++r) {
+          std::mt19937_64 rng(seed ^ (0x9E3779B97F4A7C15ull * (L * 1000003ull + r + 1)));
+          keys[r] = annealOnce(letters, L, r == 0, options, rng, scores[r]);
+        }
+        });
+      for (size_t r = 0; r < options.restarts; ++r) {
+        double adjusted = scores[r] - double(L) * std::log(26.0);
+        if (adjusted > bestScore) {
+          bestScore = adjusted;
+          bestKey = keys[r];
         }
-        return;
       }
-      for (char c = 'A'; c <= 'Z'; ++c) {
-        trailKey[pos] = c;
-        self(self, pos + 1, len);
+    }
+    return minimalPeriod(bestKey);
+  }
+
+  // --- Bsqueda exhaustiva paralela ---
+  struct SearchOptions {
+    unsigned threads = 0;  ///< 0 = hilos del hardware.
+    /// Se detiene en cuanto una clave alcanza este puntaje.
+    double stopScore = std::numeric_limits<double>::infinity();
+    /// Cancelacin cooperativa: si otro hilo lo pone en true, la bsqueda
+    /// termina pronto y devuelve lo encontrado hasta ese momento.
+    const std::atomic<bool>* cancel = nullptr;
+    /// Avance (claves probadas, claves por segundo). Se llama desde el hilo
+    /// que inici la bsqueda, cada progressSeconds y una vez al final.
+    std::function<void(uint64_t keys, double keysPerSecond)> progress;
+    double progressSeconds = 1.0;
+    /// Modo incremental: punta con bigramas de letras (NGramModel) y, al
+    /// cambiar una letra de la clave, solo vuelve a descifrar y puntuar su
+    /// columna. Los puntajes son log-verosimilitudes, no los de fitness().
+    bool incremental = false;
+  };
+
+  struct SearchResult {
+    std::vector<TopK<std::string>::Entry> best;  ///< De mejor a peor.
+    uint64_t keysTested = 0;
+    bool completed = false;  ///< false si se detuvo por stopScore o cancel.
+  };
+
+  /**
+   * @brief Prueba todas las claves de 1 a maxKeyLength letras en paralelo.
+   *
+   * Para cada longitud, el espacio 26^L se divide en fragmentos segn las
+   * primeras letras de la clave. Los hilos del pool toman fragmentos a
+   * demanda, as uno que termina antes toma trabajo de los dems. Cada hilo
+   * guarda solo clave y puntaje de sus mejores candidatos, y al final se
+   * unen los rankings.
+   */
+  static SearchResult 
+  searchKeys(const std::string& cipher,
+    int maxKeyLength,
+    size_t topK,
+    const SearchOptions& options)
+  {
+    ThreadPool pool(options.threads);
+    struct Worker {
+      Vigenere v;
+      std::string plain;                 // modo completo: texto descifrado
+      std::vector<unsigned char> cols;   // modo incremental: letras descifradas
+      std::vector<double> partial;       // modo incremental: puntaje de las columnas 0..pos-1
+      TopK<std::string> best;
+      uint64_t pending = 0;
+    };
+    std::vector<Worker> workers(pool.size(), Worker{ {}, {}, {}, {}, TopK<std::string>(topK) });
+    std::atomic<uint64_t> tested{ 0 };
+    std::atomic<bool> stop{ false };
+    const std::vector<unsigned char> letters =
+      options.incremental ? letterIndices(cipher) : std::vector<unsigned char>();
+    const NGramModel& model = NGramModel::spanish();
+
+    using Clock = std::chrono::steady_clock;
+    const auto start = Clock::now();
+    auto lastReport = start;
+    auto report = [&](Clock::time_point now) {
+      double secs = std::chrono::duration<double>(now - start).count();
+      uint64_t keys = tested.load(std::memory_order_relaxed);
+      options.progress(keys, secs > 0.0 ? double(keys) / secs : 0.0);
+      lastReport = now;
+    };
+
+    // Registra una clave probada; devuelve false si hay que detenerse.
+    auto visit = [&](unsigned id, Worker& w, double scr) -> bool {
+      if (w.best.wouldAccept(scr)) w.best.push(scr, w.v.key);
+      if (scr >= options.stopScore) stop.store(true);
+      if (++w.pending < kCheckInterval) return true;
+
+      tested.fetch_add(w.pending, std::memory_order_relaxed);
+      w.pending = 0;
+      if (options.cancel && options.cancel->load(std::memory_order_relaxed)) stop.store(true);
+      if (stop.load(std::memory_order_relaxed)) return false;
+      if (id == 0 && options.progress) {
+        auto now = Clock::now();
+        if (std::chrono::duration<double>(now - lastReport).count() >= options.progressSeconds) {
+          report(now);
+        }
       }
-      };
+      return true;
+    };
+
+    for (int L = 1; L <= maxKeyLength && !stop.load(); ++L) {
+      const size_t prefix = std::min<size_t>(static_cast<size_t>(L), kShardLetters);
+      size_t shards = 1;
+      for (size_t i = 0; i < prefix; ++i) shards *= 26;
+
+      pool.parallelFor(shards, 1, [&](unsigned id, size_t begin, size_t end) {
+        Worker& w = workers[id];
+        std::string& k = w.v.key;
+        k.assign(L, 'A');
+        if (options.incremental) {
+          w.cols.resize(letters.size());
+          w.partial.assign(L + 1, 0.0);
+        }
+        else {
+          w.plain.resize(cipher.size());
+        }
+
+        // Modo incremental: fija la letra pos y acumula el puntaje de su columna
+        auto step = [&](size_t pos) {
+          w.partial[pos + 1] = w.partial[pos]
+            + columnScore(letters, w.cols.data(), k, pos, model);
+        };
+        auto dfs = [&](auto&& self, size_t pos) -> bool {
+          for (char c = 'A'; c <= 'Z'; ++c) {
+            k[pos] = c;
+            step(pos);
+            bool more = pos + 1 == k.size()
+              ? visit(id, w, w.partial[pos + 1])
+              : self(self, pos + 1);
+            if (!more) return false;
+          }
+          return true;
+        };
+
+        for (size_t shard = begin; shard < end && !stop.load(std::memory_order_relaxed); ++shard) {
+          for (size_t i = prefix, s = shard; i-- > 0; s /= 26) k[i] = static_cast<char>('A' + s % 26);
+          std::fill(k.begin() + prefix, k.end(), 'A');
+
+          if (options.incremental) {
+            for (size_t pos = 0; pos < prefix; ++pos) step(pos);
+            if (prefix == k.size() ? !visit(id, w, w.partial[prefix]) : !dfs(dfs, prefix)) break;
+            continue;
+          }
+
+          for (;;) {
+            w.v.transformInto(cipher.data(), cipher.size(), &w.plain[0], /*encode=*/false);
+            if (!visit(id, w, fitness(w.plain))) break;
+
+            // Siguiente sufijo, como un odmetro en base 26
+            size_t i = k.size();
+            while (i > prefix && k[i - 1] == 'Z') k[--i] = 'A';
+            if (i == prefix) break;
+            ++k[i - 1];
+          }
+        }
+        tested.fetch_add(w.pending, std::memory_order_relaxed);
+        w.pending = 0;
+        });
+    }
+
+    TopK<std::string> ranking(topK);
+    for (const auto& w : workers) ranking.merge(w.best);
 
-    for (int L = 1; L <= maxKeyLength; ++L) {
-      trailKey.assign(L, 'A');
-      dfs(dfs, 0, L);
+    SearchResult result;
+    result.best = ranking.sorted();
+    result.keysTested = tested.load();
+    result.completed = !stop.load();
+    if (options.progress) report(Clock::now());
+    return result;
+  }
+
+  // --- Fuerza bruta para texto en memoria ---
+  // Devuelve la mejor clave encontrada hasta maxKeyLength. Si el texto
+  // tiene letras suficientes usa el ataque estadstico; la bsqueda
+  // exhaustiva (searchKeys) queda para textos cortos.
+  static std::string 
+  breakEncode(const std::string& text,
+    int maxKeyLength)
+  {
+    return breakEncode(text, maxKeyLength, SearchOptions());
+  }
+
+  static std::string 
+  breakEncode(const std::string& text,
+    int maxKeyLength,
+    const SearchOptions& options)
+  {
+    if (maxKeyLength > 0 && countLetters(text) >= kStatMinLetters) {
+      std::string k = breakStatistical(text, static_cast<size_t>(maxKeyLength));
+      if (!k.empty()) {
+        std::cout << "*** Vigenre (Kasiski / IC) ***\n"
+          << "Clave encontrada:   " << k << "\n"
+          << "Texto descifrado:   " << Vigenere(k).decode(text) << "\n\n";
+        return k;
+      }
     }
 
+    SearchResult r = searchKeys(text, maxKeyLength, 1, options);
+    if (r.best.empty()) return std::string();
+    const std::string& bestKey = r.best.front().value;
+
     std::cout << "*** Vigenre Brute-Force ***\n"
       << "Clave encontrada:   " << bestKey << "\n"
-      << "Texto descifrado:   " << bestPlain << "\n\n";
+      << "Texto descifrado:   " << Vigenere(bestKey).decode(text) << "\n\n";
 
     return bestKey;
   }
 
   // --- Fuerza bruta aplicada a archivo ---
   // Lee todo el archivo, lo descifra con cada clave hasta maxKeyLength,
-  // imprime en consola los N mejores candidatos segn fitness.
+  // imprime en consola los N mejores candidatos segn fitness. Solo se
+  // vuelve a descifrar el texto de los ganadores.
   static void 
   breakFile(const std::string& inputPath,
     int maxKeyLength,
-    int topCandidates = 5)
+    int topCandidates = 5,
+    unsigned threads = 0)
   {
-    std::string cipher = readFileStatic(inputPath);
-    struct Candidate { std::string key, plain; double score; };
-    std::vector<Candidate> results;
-
-    auto dfs = [&](auto&& self, int pos, int len, std::string& trailKey) -> void {
-      if (pos == len) {
-        Vigenere v(trailKey);
-        std::string candPlain = v.decode(cipher);
-        double scr = fitness(candPlain);
-        results.push_back({ trailKey, candPlain, scr });
-        return;
-      }
-      for (char c = 'A'; c <= 'Z'; ++c) {
-        trailKey[pos] = c;
-        self(self, pos + 1, len, trailKey);
-      }
-      };
+    SearchOptions options;
+    options.threads = threads;
+    breakFile(inputPath, maxKeyLength, topCandidates, options);
+  }
 
-    for (int L = 1; L <= maxKeyLength; ++L) {
-      std::string trailKey(L, 'A');
-      dfs(dfs, 0, L, trailKey);
-    }
+  static void 
+  breakFile(const std::string& inputPath,
+    int maxKeyLength,
+    int topCandidates,
+    const SearchOptions& options)
+  {
+    std::string cipher = readFileStatic(inputPath);
+    const size_t topK = static_cast<size_t>(std::max(topCandidates, 0));
+    SearchResult r = searchKeys(cipher, maxKeyLength, topK, options);
 
-    // Ordenamos y mostramos los N mejores
-    std::sort(results.begin(), results.end(),
-      [](auto& a, auto& b) { return a.score > b.score; });
     std::cout << "=== Top " << topCandidates << " claves ===\n";
-    for (int i = 0; i < std::min((int)results.size(), topCandidates); ++i) {
-      std::cout << i + 1 << ") Clave: " << results[i].key
-        << " | Score: " << results[i].score << "\n"
-        << "   Texto: " << results[i].plain << "\n\n";
+    if (!r.completed) std::cout << "(bsqueda interrumpida tras " << r.keysTested << " claves)\n";
+    for (size_t i = 0; i < r.best.size(); ++i) {
+      std::cout << i + 1 << ") Clave: " << r.best[i].value
+        << " | Score: " << r.best[i].score << "\n"
+        << "   Texto: " << Vigenere(r.best[i].value).decode(cipher) << "\n\n";
     }
   }
 
 private:
   std::string key;
+  Alphabet alphabet = Alphabet::Letters;
+
+  // --- Parmetros del ataque estadstico ---
+  static constexpr size_t kMinColumnLetters = 8;     // letras mnimas por columna
+  static constexpr size_t kStatMinLetters = 200;     // por debajo, fuerza bruta
+  static constexpr size_t kKasiskiDistances = 4096;  // distancias entre trigramas a considerar
+  static constexpr double kLanguageIoc = 0.05;       // entre aleatorio (0.038) e idioma (0.067-0.077)
+  static constexpr double kIocRatio = 0.8;           // fraccin del IC mximo para aceptar una longitud
+
+  // --- Parmetros del solver estocstico ---
+  static constexpr size_t kAnnealMinColumn = 4;      // letras mnimas por columna
+  static constexpr size_t kAnnealLengths = 12;       // longitudes (por IC) que se prueban
+  static constexpr size_t kAnnealStepsPerKey = 600;  // pasos automticos por letra de clave
+
+  // --- Parmetros de la transformacin ---
+  static constexpr size_t kSimdMinBytes = 256;      // por debajo no compensa preparar el flujo SIMD
+  static constexpr size_t kSimdMaxKey = 240;        // claves ms largas van por tablas (flujo en la pila)
+
+  // --- Parmetros de la bsqueda exhaustiva ---
+  static constexpr size_t kShardLetters = 2;         // letras de prefijo por fragmento (676 fragmentos)
+  static constexpr uint64_t kCheckInterval = 256;    // claves entre revisiones de parada y avance
 
   // --- Transformacin comn ---
   std::string 
   transform(const std::string& text, bool encode) const {
-    std::string res;
-    res.reserve(text.size());
-    unsigned int ki = 0;
+    std::string res(text.size(), '\0');
+    transformInto(text.data(), text.size(), &res[0], encode);
+    return res;
+  }
 
-    for (char c : text) {
-      if (std::isalpha(static_cast<unsigned char>(c))) {
-        bool isLower = std::islower(static_cast<unsigned char>(c));
-        char base = isLower ? 'a' : 'A';
-        int  shift = key[ki % key.size()] - 'A';
-        int  dir = encode ? +1 : -1;
-        char out = char(((c - base) + dir * shift + 26 * shift) % 26 + base);
-        res += out;
-        ++ki;
+  void 
+  transformInto(const char* in, size_t n, char* out, bool encode) const {
+    if (alphabet == Alphabet::Alnum) {
+      encode ? transformAs<true, Alphabet::Alnum>(in, n, out)
+        : transformAs<false, Alphabet::Alnum>(in, n, out);
+    }
+    else {
+      encode ? transformAs<true, Alphabet::Letters>(in, n, out)
+        : transformAs<false, Alphabet::Letters>(in, n, out);
+    }
+  }
+
+  // Especializada en compilacin por sentido y alfabeto. Bloques grandes
+  // van por SSSE3 y el resto por tablas, sin ramas por carcter.
+  template <bool Encode, Alphabet A>
+  void 
+  transformAs(const char* in, size_t n, char* out) const {
+    const auto* src = reinterpret_cast<const unsigned char*>(in);
+    auto* dst = reinterpret_cast<unsigned char*>(out);
+    if (key.empty()) {
+      if (n) std::memmove(dst, src, n);
+      return;
+    }
+
+    size_t ki = 0, done = 0;
+#if defined(CRIPTO_X86)
+    if (n >= kSimdMinBytes && key.size() <= kSimdMaxKey && Simd::hasSSSE3()) {
+      // Flujo de clave ya orientado (desplazamiento de letras y de dgitos),
+      // repetido 16 posiciones ms para leer 16 seguidas desde cualquier ki.
+      // Vive en la pila: searchKeys llama aqu una vez por clave.
+      unsigned char ks[kSimdMaxKey + 16], ks10[kSimdMaxKey + 16];
+      const size_t ksLen = key.size() + 16;
+      for (size_t i = 0; i < ksLen; ++i) {
+        unsigned s = static_cast<unsigned>(key[i % key.size()] - 'A');
+        ks[i] = static_cast<unsigned char>(Encode ? s : (26 - s) % 26);
+        ks10[i] = static_cast<unsigned char>(Encode ? s % 10 : (10 - s % 10) % 10);
       }
-      else {
-        res += c;
+      done = transformSSSE3<A>(src, dst, n, ks, ks10, key.size(), ki);
+    }
+#endif
+
+    const auto& tables = shiftTables<Encode, A>();
+    const auto& consumes = keyedBytes<A>();
+    const unsigned char* k = reinterpret_cast<const unsigned char*>(key.data());
+    const size_t len = key.size();
+    for (size_t i = done; i < n; ++i) {
+      const unsigned char c = src[i];
+      dst[i] = tables[k[ki] - 'A'][c];
+      ki += consumes[c];
+      ki = ki == len ? 0 : ki;
+    }
+  }
+
+  // Tabla por letra de clave: byte -> byte cifrado (o descifrado).
+  template <bool Encode, Alphabet A>
+  static const std::array<std::array<unsigned char, 256>, 26>& 
+  shiftTables() {
+    static const auto tables = [] {
+      std::array<std::array<unsigned char, 256>, 26> t;
+      for (int s = 0; s < 26; ++s) {
+        const int sl = Encode ? s : (26 - s) % 26;
+        const int sd = Encode ? s % 10 : (10 - s % 10) % 10;
+        for (int c = 0; c < 256; ++c) {
+          int r = c;
+          if (c >= 'A' && c <= 'Z') r = 'A' + (c - 'A' + sl) % 26;
+          else if (c >= 'a' && c <= 'z') r = 'a' + (c - 'a' + sl) % 26;
+          else if (A == Alphabet::Alnum && c >= '0' && c <= '9') r = '0' + (c - '0' + sd) % 10;
+          t[s][c] = static_cast<unsigned char>(r);
+        }
       }
+      return t;
+    }();
+    return tables;
+  }
+
+  // 1 para los bytes que consumen una letra de clave.
+  template <Alphabet A>
+  static const std::array<unsigned char, 256>& 
+  keyedBytes() {
+    static const auto table = [] {
+      std::array<unsigned char, 256> t{};
+      for (int c = 'A'; c <= 'Z'; ++c) t[c] = t[c + 32] = 1;
+      if (A == Alphabet::Alnum) {
+        for (int c = '0'; c <= '9'; ++c) t[c] = 1;
+      }
+      return t;
+    }();
+    return table;
+  }
+
+#if defined(CRIPTO_X86)
+  // 16 bytes por iteracin. La suma de prefijos de la mscara de smbolos
+  // da, para cada byte, cuntos smbolos lo preceden en el bloque; con ese
+  // rango pshufb toma su desplazamiento del flujo de clave, as cada
+  // smbolo recibe la letra que le toca sin compactar ni dispersar bytes.
+  template <Alphabet A>
+  CRIPTO_TARGET("ssse3") static size_t 
+  transformSSSE3(const unsigned char* src, unsigned char* dst, size_t n,
+    const unsigned char* ks, const unsigned char* ks10, size_t keyLen, size_t& ki)
+  {
+    const __m128i flip = _mm_set1_epi8(static_cast<char>(0x80));
+    const __m128i lim26 = _mm_set1_epi8(static_cast<char>(0x80 + 26));
+    const __m128i lim10 = _mm_set1_epi8(static_cast<char>(0x80 + 10));
+    const __m128i n25 = _mm_set1_epi8(25);
+    const __m128i n26 = _mm_set1_epi8(26);
+    const __m128i n9 = _mm_set1_epi8(9);
+    const __m128i n10 = _mm_set1_epi8(10);
+    const __m128i lowerBit = _mm_set1_epi8(0x20);
+    const __m128i one = _mm_set1_epi8(1);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      const __m128i c = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+
+      // Letras: ndice 0..25 sin importar maysculas (comparacin sin signo)
+      const __m128i li = _mm_sub_epi8(_mm_or_si128(c, lowerBit), _mm_set1_epi8('a'));
+      const __m128i isL = _mm_cmplt_epi8(_mm_xor_si128(li, flip), lim26);
+      __m128i mask = isL;
+      __m128i di = _mm_setzero_si128(), isD = _mm_setzero_si128();
+      if (A == Alphabet::Alnum) {
+        di = _mm_sub_epi8(c, _mm_set1_epi8('0'));
+        isD = _mm_cmplt_epi8(_mm_xor_si128(di, flip), lim10);
+        mask = _mm_or_si128(mask, isD);
+      }
+
+      // Rango exclusivo de cada byte entre los smbolos del bloque
+      const __m128i ones = _mm_and_si128(mask, one);
+      __m128i rank = _mm_add_epi8(ones, _mm_slli_si128(ones, 1));
+      rank = _mm_add_epi8(rank, _mm_slli_si128(rank, 2));
+      rank = _mm_add_epi8(rank, _mm_slli_si128(rank, 4));
+      rank = _mm_add_epi8(rank, _mm_slli_si128(rank, 8));
+      rank = _mm_sub_epi8(rank, ones);
+
+      const __m128i s = _mm_shuffle_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(ks + ki)), rank);
+      __m128i v = _mm_add_epi8(li, s);
+      v = _mm_sub_epi8(v, _mm_and_si128(_mm_cmpgt_epi8(v, n25), n26));
+      const __m128i letters = _mm_or_si128(_mm_add_epi8(v, _mm_set1_epi8('A')),
+        _mm_and_si128(c, lowerBit));
+      __m128i r = _mm_or_si128(_mm_and_si128(isL, letters), _mm_andnot_si128(isL, c));
+
+      if (A == Alphabet::Alnum) {
+        const __m128i s10 = _mm_shuffle_epi8(
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(ks10 + ki)), rank);
+        __m128i d = _mm_add_epi8(di, s10);
+        d = _mm_sub_epi8(d, _mm_and_si128(_mm_cmpgt_epi8(d, n9), n10));
+        const __m128i digits = _mm_add_epi8(d, _mm_set1_epi8('0'));
+        r = _mm_or_si128(_mm_and_si128(isD, digits), _mm_andnot_si128(isD, r));
+      }
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), r);
+
+      ki += static_cast<size_t>(popcount16(static_cast<unsigned>(_mm_movemask_epi8(mask))));
+      if (ki >= keyLen) ki %= keyLen;
     }
-    return res;
+    return i;
+  }
+
+  static int 
+  popcount16(unsigned x) {
+    x = x - ((x >> 1) & 0x5555);
+    x = (x & 0x3333) + ((x >> 2) & 0x3333);
+    x = (x + (x >> 4)) & 0x0F0F;
+    return static_cast<int>((x + (x >> 8)) & 0x1F);
+  }
+#endif
+
+  // --- Ataque estadstico: auxiliares ---
+  // Letras del texto como 0..25, en orden: son las nicas que consumen clave.
+  static std::vector<unsigned char> 
+  letterIndices(const std::string& text) {
+    std::vector<unsigned char> letters;
+    letters.reserve(text.size());
+    for (unsigned char c : text) {
+      if (c >= 'A' && c <= 'Z') letters.push_back(static_cast<unsigned char>(c - 'A'));
+      else if (c >= 'a' && c <= 'z') letters.push_back(static_cast<unsigned char>(c - 'a'));
+    }
+    return letters;
+  }
+
+  static size_t 
+  countLetters(const std::string& text) {
+    size_t n = 0;
+    for (unsigned char c : text) {
+      n += (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    }
+    return n;
+  }
+
+  // IC medio de las L columnas (letras i, i + L, i + 2L, ...).
+  static double 
+  columnCoincidence(const std::vector<unsigned char>& letters, size_t L) {
+    std::vector<std::array<uint64_t, 26>> hist(L);
+    for (auto& h : hist) h.fill(0);
+    for (size_t i = 0, col = 0; i < letters.size(); ++i) {
+      ++hist[col][letters[i]];
+      if (++col == L) col = 0;
+    }
+    double sum = 0.0;
+    for (size_t col = 0; col < L; ++col) {
+      uint64_t total = letters.size() / L + (col < letters.size() % L);
+      sum += TextStatistics::indexOfCoincidence(hist[col].data(), 26, total);
+    }
+    return sum / double(L);
+  }
+
+  // Examen de Kasiski: la distancia entre trigramas repetidos suele ser
+  // mltiplo de la longitud de la clave. Devuelve la longitud que divide ms
+  // distancias por encima de lo esperado al azar (1/L), o 0 si no hay.
+  static size_t 
+  kasiskiLength(const std::vector<unsigned char>& letters, size_t maxLen) {
+    std::vector<size_t> distances;
+    std::vector<int64_t> last(26 * 26 * 26, -1);
+    for (size_t i = 0; i + 3 <= letters.size() && distances.size() < kKasiskiDistances; ++i) {
+      size_t tri = (letters[i] * 26 + letters[i + 1]) * 26 + letters[i + 2];
+      if (last[tri] >= 0) distances.push_back(i - static_cast<size_t>(last[tri]));
+      last[tri] = static_cast<int64_t>(i);
+    }
+
+    size_t best = 0;
+    double bestExcess = 0.0;
+    for (size_t L = 2; L <= maxLen && !distances.empty(); ++L) {
+      size_t hits = 0;
+      for (size_t d : distances) hits += (d % L == 0);
+      double excess = double(hits) / double(distances.size()) - 1.0 / double(L);
+      if (excess > bestExcess) {
+        bestExcess = excess;
+        best = L;
+      }
+    }
+    return best;
+  }
+
+  // Elige cada letra de la clave minimizando el chi-cuadrado de su columna,
+  // para espaol y para ingls; se queda con el idioma cuyo texto completo
+  // descifrado tiene menor chi-cuadrado.
+  static std::string 
+  solveColumns(const std::vector<unsigned char>& letters, size_t L) {
+    std::vector<std::array<uint64_t, 26>> hist(L);
+    for (auto& h : hist) h.fill(0);
+    for (size_t i = 0, col = 0; i < letters.size(); ++i) {
+      ++hist[col][letters[i]];
+      if (++col == L) col = 0;
+    }
+
+    std::string best;
+    double bestChi = std::numeric_limits<double>::infinity();
+    for (auto lang : { TextStatistics::Language::Spanish, TextStatistics::Language::English }) {
+      std::string k(L, 'A');
+      uint64_t plain[26] = {};
+      uint64_t total = 0;
+      for (size_t col = 0; col < L; ++col) {
+        uint64_t colTotal = 0;
+        for (uint64_t c : hist[col]) colTotal += c;
+        double bestCol = std::numeric_limits<double>::infinity();
+        int shift = 0;
+        for (int s = 0; s < 26; ++s) {
+          // La letra clara i aparece cifrada como (i + s) % 26
+          uint64_t rotadas[26];
+          for (int i = 0; i < 26; ++i) rotadas[i] = hist[col][(i + s) % 26];
+          double c = TextStatistics::chiSquared(rotadas, colTotal, lang);
+          if (c < bestCol) {
+            bestCol = c;
+            shift = s;
+          }
+        }
+        k[col] = static_cast<char>('A' + shift);
+        for (int i = 0; i < 26; ++i) plain[i] += hist[col][(i + shift) % 26];
+        total += colTotal;
+      }
+      double c = TextStatistics::chiSquared(plain, total, lang);
+      if (c < bestChi) {
+        bestChi = c;
+        best = k;
+      }
+    }
+    return best;
+  }
+
+  // --- Solver estocstico: auxiliares ---
+  // Texto descifrado (letras 0..25) con una clave de L desplazamientos y su
+  // puntaje de cuadrigramas, que se actualiza al cambiar una sola columna.
+  struct QuadgramState {
+    const std::vector<unsigned char>& letters;
+    const float* quad;
+    size_t L;
+    std::vector<unsigned char> shift, plain;
+    double score = 0.0;
+
+    QuadgramState(const std::vector<unsigned char>& cipher, const std::vector<unsigned char>& key)
+      : letters(cipher), quad(NGramModel::spanish().quadgrams()), L(key.size()),
+      shift(key), plain(cipher.size()) {
+      for (size_t t = 0, col = 0; t < letters.size(); ++t) {
+        plain[t] = decodeLetter(letters[t], shift[col]);
+        if (++col == L) col = 0;
+      }
+      score = NGramModel::spanish().quadgramScore(plain.data(), plain.size());
+    }
+
+    static unsigned char
+    decodeLetter(unsigned char c, unsigned char s) {
+      return static_cast<unsigned char>(c >= s ? c - s : c + 26 - s);
+    }
+
+    // Suma de las ventanas que contienen alguna letra de la columna j. Con
+    // L >= 4 las ventanas de letras distintas de la columna no se repiten.
+    double
+    columnWindows(size_t j) const {
+      if (L < 4) return NGramModel::spanish().quadgramScore(plain.data(), plain.size());
+      const size_t n = plain.size();
+      const unsigned char* p = plain.data();
+      double sum = 0.0;
+      for (size_t t = j; t < n; t += L) {
+        for (size_t e = std::max<size_t>(t, 3); e < std::min(n, t + 4); ++e) {
+          sum += quad[NGramModel::quadIndex(p[e - 3], p[e - 2], p[e - 1], p[e])];
+        }
+      }
+      return sum;
+    }
+
+    // Cambia el desplazamiento de la columna j y devuelve la variacin del puntaje.
+    double
+    setColumn(size_t j, unsigned char s) {
+      double before = columnWindows(j);
+      shift[j] = s;
+      for (size_t t = j; t < plain.size(); t += L) plain[t] = decodeLetter(letters[t], s);
+      double delta = columnWindows(j) - before;
+      score += delta;
+      return delta;
+    }
+  };
+
+  // Un arranque de recocido simulado ms pulido final; devuelve la clave y
+  // deja su puntaje de cuadrigramas en 'score'.
+  static std::string 
+  annealOnce(const std::vector<unsigned char>& letters, size_t L, bool fromChi,
+    const AnnealOptions& options, std::mt19937_64& rng, double& score)
+  {
+    std::vector<unsigned char> key(L);
+    if (fromChi) {
+      std::string k = solveColumns(letters, L);
+      for (size_t j = 0; j < L; ++j) key[j] = static_cast<unsigned char>(k[j] - 'A');
+    }
+    else {
+      for (auto& s : key) s = static_cast<unsigned char>(rng() % 26);
+    }
+    QuadgramState st(letters, key);
+
+    const size_t steps = options.iterations ? options.iterations : kAnnealStepsPerKey * L;
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    std::vector<unsigned char> best = st.shift;
+    double bestScore = st.score;
+    for (size_t it = 0; it < steps; ++it) {
+      const double T = options.temperature * (1.0 - double(it) / double(steps));
+      const size_t j = rng() % L;
+      const unsigned char old = st.shift[j];
+      const unsigned char s = static_cast<unsigned char>((old + 1 + rng() % 25) % 26);
+      double delta = st.setColumn(j, s);
+      if (delta < 0.0 && (T <= 0.0 || unit(rng) >= std::exp(delta / T))) {
+        st.setColumn(j, old);
+        continue;
+      }
+      if (st.score > bestScore) {
+        bestScore = st.score;
+        best = st.shift;
+      }
+    }
+
+    // Pulido: mejor letra para cada columna hasta que nada mejore
+    QuadgramState fin(letters, best);
+    for (bool improved = true; improved;) {
+      improved = false;
+      for (size_t j = 0; j < L; ++j) {
+        unsigned char bestShift = fin.shift[j];
+        double base = fin.score;
+        for (unsigned char s = 0; s < 26; ++s) {
+          fin.setColumn(j, s);
+          if (fin.score > base + 1e-9) {
+            base = fin.score;
+            bestShift = s;
+            improved = true;
+          }
+        }
+        fin.setColumn(j, bestShift);
+      }
+    }
+
+    score = fin.score;
+    std::string k(L, 'A');
+    for (size_t j = 0; j < L; ++j) k[j] = static_cast<char>('A' + fin.shift[j]);
+    return k;
+  }
+
+  // Descifra la columna pos (letras pos, pos + L, ...) con k[pos] y devuelve
+  // su parte de NGramModel::score: los bigramas que terminan en la columna
+  // (ms el unigrama inicial en la primera) y, al cerrar la clave, los que
+  // cruzan de la ltima columna a la primera. La suma sobre pos = 0..L-1 es
+  // el puntaje del texto completo y cada trmino usa solo columnas fijadas.
+  static double 
+  columnScore(const std::vector<unsigned char>& letters, unsigned char* plain,
+    const std::string& k, size_t pos, const NGramModel& model)
+  {
+    const size_t L = k.size();
+    const size_t n = letters.size();
+    const unsigned shift = 26 - static_cast<unsigned>(k[pos] - 'A');
+    const float* bi = model.bigrams();
+    double sum = 0.0;
+    for (size_t t = pos; t < n; t += L) {
+      unsigned p = letters[t] + shift;
+      plain[t] = static_cast<unsigned char>(p >= 26 ? p - 26 : p);
+    }
+    if (pos == 0 && n > 0) sum += model.unigram(plain[0]);
+    if (pos > 0) {
+      for (size_t t = pos; t < n; t += L) sum += bi[plain[t - 1] * 26 + plain[t]];
+    }
+    if (pos + 1 == L) {
+      for (size_t t = L; t < n; t += L) sum += bi[plain[t - 1] * 26 + plain[t]];
+    }
+    return sum;
+  }
+
+  // Reduce "ABCABC" a "ABC": la clave ms corta que genera el mismo flujo.
+  static std::string 
+  minimalPeriod(const std::string& k) {
+    for (size_t p = 1; p < k.size(); ++p) {
+      if (k.size() % p != 0) continue;
+      bool periodic = true;
+      for (size_t i = p; i < k.size() && periodic; ++i) {
+        periodic = k[i] == k[i - p];
+      }
+      if (periodic) return k.substr(0, p);
+    }
+    return k;
   }
 
   // --- Fitness (mismo de tu versin) ---
@@ -180,15 +933,10 @@ private:
         " UNO ", " OTRO ", " NUEVO ", " SIN ", " ENTRE ",
         " SOBRE "
     };
-    double score = 0;
-    for (auto& w : comunes) {
-      size_t pos = 0;
-      while ((pos = text.find(w, pos)) != std::string::npos) {
-        score += w.length();
-        pos += w.length();
-      }
-    }
-    return score;
+    // Un solo recorrido del texto para todas las palabras; cada aparicin
+    // (sin solaparse con otra de la misma palabra) suma su longitud.
+    static const AhoCorasick automata(comunes);
+    return automata.score(text.data(), text.size());
   }
 
   // --- Lectura/escritura de archivos ---
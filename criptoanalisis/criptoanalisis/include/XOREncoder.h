@@ -1,91 +1,295 @@
 #pragma once
 #include "Prerequisites.h"
+#include "CandidateArchive.h"
+#include "MappedFile.h"
+#include "Simd.h"
+#include "TextStatistics.h"
+#include "ThreadPool.h"
+#include "TopK.h"
+#if defined(_WIN32)
+#include <io.h>
+#include <fcntl.h>
+#endif
 
 class XOREncoder {
 public:
+  static constexpr size_t kDefaultChunk = 1 << 20;  ///< 1 MiB por bloque en modo streaming.
+
   XOREncoder() = default;
   ~XOREncoder() = default;
 
   // --- Texto en memoria ---
   std::string encode(const std::string& input, const std::string& key) const {
     std::string output = input;
-    for (size_t i = 0; i < input.size(); ++i) {
-      output[i] = input[i] ^ key[i % key.size()];
-    }
+    xorInPlace(reinterpret_cast<unsigned char*>(&output[0]), output.size(),
+      reinterpret_cast<const unsigned char*>(key.data()), key.size());
     return output;
   }
 
+  // --- Kernel XOR de clave repetida ---
+  // Aplica data[i] ^= key[(phase + i) % keyLen] sobre el buffer en sitio y
+  // devuelve la fase con la que contina el siguiente byte. Elige en tiempo
+  // de ejecucin entre AVX2, SSE2 o la versin escalar.
+  static size_t xorInPlace(unsigned char* data, size_t n,
+    const unsigned char* key, size_t keyLen,
+    size_t phase = 0)
+  {
+    if (keyLen == 0) throw std::invalid_argument("La clave no puede estar vaca.");
+    phase %= keyLen;
+    if (n == 0) return phase;
+
+    std::vector<unsigned char> pattern;
+    expandKey(key, keyLen, pattern);
+    return xorPattern(data, n, pattern.data(), keyLen, phase);
+  }
+
   // --- I/O de archivos ---
+  // Cifra por bloques con memoria constante (ver encryptStream). Una ruta
+  // "-" usa la entrada o salida estndar, para trabajar con tuberas.
+  // La salida se escribe en un temporal junto al destino y se renombra al
+  // terminar: as inPath == outPath cifra en sitio y un error no deja el
+  // destino a medias.
   void encryptFile(const std::string& inPath,
     const std::string& outPath,
-    const std::string& key) const
+    const std::string& key,
+    size_t chunkSize = kDefaultChunk) const
   {
-    auto buf = readFile(inPath);
-    std::string plain(reinterpret_cast<const char*>(buf.data()), buf.size());
-    std::string cipher = encode(plain, key);
-    writeFile(outPath,
-      std::vector<unsigned char>(cipher.begin(), cipher.end()));
+    if (outPath == "-") {
+      std::ifstream inFile;
+      std::ofstream outFile;
+      std::istream& in = openInput(inPath, inFile);
+      std::ostream& out = openOutput(outPath, outFile);
+      encryptStream(in, out, key, chunkSize);
+      return;
+    }
+
+    const std::string tmpPath = tempPathFor(outPath);
+    try {
+      {
+        std::ifstream inFile;
+        std::ofstream outFile;
+        std::istream& in = openInput(inPath, inFile);
+        std::ostream& out = openOutput(tmpPath, outFile);
+        encryptStream(in, out, key, chunkSize);
+        outFile.close();
+        if (!outFile) throw std::runtime_error("No se pudo escribir: " + tmpPath);
+      }
+      fs::rename(tmpPath, outPath);
+    }
+    catch (...) {
+      std::error_code ec;
+      fs::remove(tmpPath, ec);
+      throw;
+    }
   }
 
   // Para XOR, encriptar y desencriptar es la misma operacin
   void decryptFile(const std::string& inPath,
     const std::string& outPath,
-    const std::string& key) const
+    const std::string& key,
+    size_t chunkSize = kDefaultChunk) const
+  {
+    encryptFile(inPath, outPath, key, chunkSize);
+  }
+
+  // --- Modo streaming ---
+  // Lee en bloques de chunkSize sobre un doble buffer: un hilo lector llena
+  // un bloque mientras este hilo aplica XOR al otro y lo escribe. La fase
+  // de la clave contina entre bloques, as el resultado es idntico al de
+  // cifrar todo de una vez, y la memoria usada es siempre 2 * chunkSize.
+  void encryptStream(std::istream& in,
+    std::ostream& out,
+    const std::string& key,
+    size_t chunkSize = kDefaultChunk) const
   {
-    encryptFile(inPath, outPath, key);
+    if (key.empty()) throw std::invalid_argument("La clave no puede estar vaca.");
+    if (chunkSize == 0) throw std::invalid_argument("El tamao de bloque debe ser mayor que cero.");
+
+    struct Slot {
+      std::vector<unsigned char> data;
+      size_t size = 0;
+      bool full = false;
+      bool last = false;
+    };
+    Slot slots[2];
+    for (auto& s : slots) s.data.resize(chunkSize);
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool abort = false;
+    std::exception_ptr readError;
+
+    std::thread reader([&] {
+      try {
+        for (int cur = 0;; cur ^= 1) {
+          Slot& s = slots[cur];
+          {
+            std::unique_lock<std::mutex> lock(mtx);
+            cv.wait(lock, [&] { return !s.full || abort; });
+            if (abort) return;
+          }
+          in.read(reinterpret_cast<char*>(s.data.data()), chunkSize);
+          size_t got = static_cast<size_t>(in.gcount());
+          if (in.bad()) throw std::runtime_error("Error de lectura en el flujo de entrada.");
+          bool last = got < chunkSize;
+          {
+            std::lock_guard<std::mutex> lock(mtx);
+            s.size = got;
+            s.last = last;
+            s.full = true;
+          }
+          cv.notify_all();
+          if (last) return;
+        }
+      }
+      catch (...) {
+        std::lock_guard<std::mutex> lock(mtx);
+        readError = std::current_exception();
+        slots[0].full = slots[1].full = true;
+        slots[0].last = slots[1].last = true;
+        cv.notify_all();
+      }
+      });
+
+    const auto* k = reinterpret_cast<const unsigned char*>(key.data());
+    size_t phase = 0;
+    try {
+      for (int cur = 0;; cur ^= 1) {
+        Slot& s = slots[cur];
+        {
+          std::unique_lock<std::mutex> lock(mtx);
+          cv.wait(lock, [&] { return s.full; });
+          if (readError) break;
+        }
+        phase = xorInPlace(s.data.data(), s.size, k, key.size(), phase);
+        out.write(reinterpret_cast<const char*>(s.data.data()), s.size);
+        if (!out) throw std::runtime_error("Error de escritura en el flujo de salida.");
+        bool last = s.last;
+        {
+          std::lock_guard<std::mutex> lock(mtx);
+          s.full = false;
+        }
+        cv.notify_all();
+        if (last) break;
+      }
+    }
+    catch (...) {
+      {
+        std::lock_guard<std::mutex> lock(mtx);
+        abort = true;
+      }
+      cv.notify_all();
+      reader.join();
+      throw;
+    }
+    reader.join();
+    if (readError) std::rethrow_exception(readError);
+    out.flush();
+  }
+
+  // --- Ataque estadstico a clave repetida ---
+  // Recupera claves de hasta maxKeyLen bytes sin bsqueda exhaustiva:
+  //  1) estima la longitud con la distancia de Hamming normalizada entre
+  //     bloques consecutivos y el ndice de coincidencia de cada columna;
+  //  2) resuelve cada columna de la clave por separado, eligiendo el byte
+  //     que hace ms probable el texto segn frecuencias de bytes.
+  // Cuesta O(n  maxKeyLen + keyLen  256) en lugar de 256^keyLen.
+  std::string breakRepeatingKey(const std::string& cipher,
+    size_t maxKeyLen = 64) const
+  {
+    return breakRepeatingKey(
+      reinterpret_cast<const unsigned char*>(cipher.data()), cipher.size(), maxKeyLen);
+  }
+
+  // Descifra el archivo con la clave recuperada y devuelve esa clave.
+  std::string breakRepeatingKeyFile(const std::string& inPath,
+    const std::string& outPath,
+    size_t maxKeyLen = 64) const
+  {
+    auto buf = readFile(inPath);
+    std::string key = breakRepeatingKey(buf.data(), buf.size(), maxKeyLen);
+    if (!key.empty()) {
+      xorInPlace(buf.data(), buf.size(),
+        reinterpret_cast<const unsigned char*>(key.data()), key.size());
+    }
+    writeFile(outPath, buf);
+
+    std::ostringstream hex;
+    for (unsigned char c : key) {
+      hex << std::hex << std::setw(2) << std::setfill('0') << int(c);
+    }
+    std::cout << "Clave recuperada (" << key.size() << " bytes): 0x" << hex.str()
+      << "  '" << key << "'\n"
+      << "Guardado: " << outPath << "\n";
+    return key;
   }
 
   // --- Fuerza bruta 1 byte sobre archivo ---
-  // Genera un archivo descifrado por cada posible valor de byte [0..255]
+  // Prueba los 256 valores de byte y guarda los maxResults candidatos
+  // legibles con mejor puntaje en un nico archivo outDir/xor1b.cand
+  // (ver CandidateArchive). Con keyOnly solo se guardan las claves.
   void bruteForce1ByteFile(const std::string& inPath,
-    const std::string& outDir) const
+    const std::string& outDir,
+    size_t maxResults = 16,
+    bool keyOnly = false) const
   {
     auto buf = readFile(inPath);
     fs::create_directories(outDir);
+    CandidateArchive archive(maxResults);
+    std::vector<unsigned char> plain(buf.size()), pattern;
     for (int k = 0; k < 256; ++k) {
-      std::string key(1, static_cast<char>(k));
-      std::string decoded;
-      decoded.reserve(buf.size());
-      for (auto b : buf) decoded += static_cast<char>(b ^ k);
-
-      // Solo guardamos si el texto resultante parece legible
-      if (isValidText(decoded)) {
-        std::ostringstream fname;
-        fname << outDir << "/xor1b_0x"
-          << std::hex << std::setw(2) << std::setfill('0') << k
-          << ".bin";
-        writeFile(fname.str(),
-          std::vector<unsigned char>(decoded.begin(), decoded.end()));
-        std::cout << "Guardado: " << fname.str() << "\n";
+      const unsigned char key = static_cast<unsigned char>(k);
+      expandKey(&key, 1, pattern);
+      // Solo se ordenan los textos que parecen legibles
+      if (decodeIfReadable(buf.data(), buf.size(), pattern.data(), 1, plain.data())) {
+        archive.offer(TextStatistics::meanLogProbability(plain.data(), plain.size()),
+          std::string(1, static_cast<char>(k)));
       }
     }
+    saveCandidates(archive, buf, outDir + "/xor1b.cand", keyOnly);
   }
 
   // --- Fuerza bruta 2 bytes sobre archivo ---
+  // Reparte las 65.536 claves entre todos los ncleos. Cada hilo descifra
+  // en su propio buffer reutilizable y guarda solo (clave, puntaje) de los
+  // candidatos legibles; los maxResults mejores van a outDir/xor2b.cand.
   void bruteForce2ByteFile(const std::string& inPath,
-    const std::string& outDir) const
+    const std::string& outDir,
+    size_t maxResults = 16,
+    unsigned threads = 0,
+    bool keyOnly = false) const
   {
     auto buf = readFile(inPath);
     fs::create_directories(outDir);
-    for (int b1 = 0; b1 < 256; ++b1) {
-      for (int b2 = 0; b2 < 256; ++b2) {
-        std::string decoded;
-        decoded.reserve(buf.size());
-        for (size_t i = 0; i < buf.size(); ++i) {
-          int keyByte = (i % 2 == 0 ? b1 : b2);
-          decoded += static_cast<char>(buf[i] ^ keyByte);
-        }
-        if (isValidText(decoded)) {
-          std::ostringstream fname;
-          fname << outDir << "/xor2b_0x"
-            << std::hex << std::setw(2) << std::setfill('0') << b1
-            << "_0x" << std::setw(2) << b2 << ".bin";
-          writeFile(fname.str(),
-            std::vector<unsigned char>(decoded.begin(), decoded.end()));
-          std::cout << "Guardado: " << fname.str() << "\n";
-        }
+
+    ThreadPool pool(threads);
+    struct Worker {
+      std::vector<unsigned char> plain, pattern;
+      TopK<uint16_t> best;
+    };
+    std::vector<Worker> workers(pool.size(), Worker{ {}, {}, TopK<uint16_t>(maxResults) });
+
+    pool.parallelFor(1u << 16, 256, [&](unsigned w, size_t begin, size_t end) {
+      Worker& self = workers[w];
+      self.plain.resize(buf.size());
+      for (size_t k = begin; k < end; ++k) {
+        const unsigned char key[2] = {
+          static_cast<unsigned char>(k >> 8), static_cast<unsigned char>(k) };
+        expandKey(key, 2, self.pattern);
+        if (!decodeIfReadable(buf.data(), buf.size(), self.pattern.data(), 2,
+          self.plain.data())) continue;
+        self.best.push(TextStatistics::meanLogProbability(self.plain.data(), self.plain.size()),
+          static_cast<uint16_t>(k));
+      }
+      });
+
+    CandidateArchive archive(maxResults);
+    for (auto& w : workers) {
+      for (const auto& e : w.best.sorted()) {
+        const char key[2] = { static_cast<char>(e.value >> 8), static_cast<char>(e.value) };
+        archive.offer(e.score, std::string(key, 2));
       }
     }
+    saveCandidates(archive, buf, outDir + "/xor2b.cand", keyOnly);
   }
 
   // --- Fuerza bruta con diccionario sobre archivo ---
@@ -98,25 +302,403 @@ public:
     };
     auto buf = readFile(inPath);
     fs::create_directories(outDir);
+    std::vector<unsigned char> decoded(buf.size()), pattern;
     for (auto& key : comunes) {
-      std::string decoded;
-      decoded.reserve(buf.size());
-      for (size_t i = 0; i < buf.size(); ++i) {
-        decoded += static_cast<char>(buf[i] ^ key[i % key.size()]);
-      }
-      if (isValidText(decoded)) {
+      expandKey(reinterpret_cast<const unsigned char*>(key.data()), key.size(), pattern);
+      if (decodeIfReadable(buf.data(), buf.size(), pattern.data(), key.size(),
+        decoded.data())) {
         std::ostringstream fname;
         fname << outDir << "/xor_dict_" << key << ".bin";
-        writeFile(fname.str(),
-          std::vector<unsigned char>(decoded.begin(), decoded.end()));
+        writeFile(fname.str(), decoded);
         std::cout << "Guardado: " << fname.str()
           << "  (key='" << key << "')\n";
       }
     }
   }
 
+  // --- Ataque de diccionario con lista de palabras externa ---
+  struct KeyCandidate {
+    std::string key;
+    double score;  // log-probabilidad media por byte del texto descifrado
+  };
+
+  // Proyecta la lista en memoria (puede ocupar varios GB), la divide en
+  // trozos alineados a lneas y los reparte entre los hilos. Cada lnea se
+  // prueba directamente sobre la proyeccin, sin construir std::string, y
+  // solo los topK mejores candidatos legibles se conservan.
+  std::vector<KeyCandidate> bruteForceWordlistFile(const std::string& inPath,
+    const std::string& wordlistPath,
+    size_t topK = 10,
+    unsigned threads = 0) const
+  {
+    auto buf = readFile(inPath);
+    MappedFile words(wordlistPath);
+    const unsigned char* base = words.data();
+    const size_t size = words.size();
+
+    ThreadPool pool(threads);
+    const size_t shardCount = std::max<size_t>(1,
+      std::min<size_t>(size / kMinShard, size_t(pool.size()) * 64));
+    std::vector<size_t> bounds(shardCount + 1, size);
+    bounds[0] = 0;
+    for (size_t i = 1; i < shardCount; ++i) {
+      size_t pos = std::max(size / shardCount * i, bounds[i - 1]);
+      auto nl = static_cast<const unsigned char*>(
+        pos < size ? std::memchr(base + pos, '\n', size - pos) : nullptr);
+      bounds[i] = nl ? size_t(nl - base) + 1 : size;
+    }
+
+    struct WordRef { size_t offset; size_t length; };
+    struct Worker {
+      std::vector<unsigned char> plain, pattern;
+      TopK<WordRef> best;
+    };
+    std::vector<Worker> workers(pool.size(), Worker{ {}, {}, TopK<WordRef>(topK) });
+    std::atomic<uint64_t> tested{ 0 };
+
+    pool.parallelFor(shardCount, 1, [&](unsigned w, size_t begin, size_t end) {
+      Worker& self = workers[w];
+      self.plain.resize(buf.size());
+      uint64_t count = 0;
+      for (size_t shard = begin; shard < end; ++shard) {
+        size_t pos = bounds[shard];
+        const size_t stop = bounds[shard + 1];
+        while (pos < stop) {
+          auto nl = static_cast<const unsigned char*>(
+            std::memchr(base + pos, '\n', stop - pos));
+          size_t lineEnd = nl ? size_t(nl - base) : stop;
+          size_t len = lineEnd - pos;
+          if (len > 0 && base[pos + len - 1] == '\r') --len;
+          if (len > 0) {
+            ++count;
+            expandKey(base + pos, len, self.pattern);
+            if (decodeIfReadable(buf.data(), buf.size(), self.pattern.data(), len,
+              self.plain.data())) {
+              self.best.push(TextStatistics::meanLogProbability(self.plain.data(),
+                self.plain.size()), WordRef{ pos, len });
+            }
+          }
+          pos = lineEnd + 1;
+        }
+      }
+      tested += count;
+      });
+
+    TopK<WordRef> ranking(topK);
+    for (auto& w : workers) ranking.merge(w.best);
+
+    std::vector<KeyCandidate> results;
+    for (const auto& e : ranking.sorted()) {
+      results.push_back({ std::string(reinterpret_cast<const char*>(base + e.value.offset),
+        e.value.length), e.score });
+    }
+
+    std::cout << "Claves probadas: " << tested.load() << "\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+      std::cout << i + 1 << ") key='" << results[i].key
+        << "'  score=" << results[i].score << "\n";
+    }
+    return results;
+  }
+
 private:
+  static constexpr size_t kMaxVector = 32;  // bytes de un registro AVX2
+
+  // Clave expandida: la clave repetida hasta cubrir keyLen + un registro,
+  // as el patrn de cualquier fase se carga con una sola lectura. Reutiliza
+  // la capacidad del vector, de modo que en un bucle no vuelve a reservar.
+  static void expandKey(const unsigned char* key, size_t keyLen,
+    std::vector<unsigned char>& pattern)
+  {
+    pattern.resize(keyLen + kMaxVector);
+    for (size_t i = 0; i < pattern.size(); ++i) pattern[i] = key[i % keyLen];
+  }
+
+  // XOR con un patrn ya expandido; phase debe estar en [0, keyLen).
+  static size_t xorPattern(unsigned char* data, size_t n,
+    const unsigned char* pattern, size_t keyLen, size_t phase)
+  {
+    size_t done = 0;
+#if defined(CRIPTO_X86)
+    if (Simd::hasAVX2()) {
+      done = xorAVX2(data, n, pattern, keyLen, phase);
+    }
+    else if (Simd::hasSSE2()) {
+      done = xorSSE2(data, n, pattern, keyLen, phase);
+    }
+#endif
+    return xorScalar(data + done, n - done, pattern, keyLen, phase);
+  }
+
+  // --- Variantes del kernel XOR ---
+  // Cada una procesa los bloques completos de su ancho, actualiza la fase y
+  // devuelve cuntos bytes consumi; el resto lo termina xorScalar.
+  static size_t xorScalar(unsigned char* data, size_t n,
+    const unsigned char* pattern, size_t keyLen, size_t& phase)
+  {
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+      uint64_t d, k;
+      std::memcpy(&d, data + i, 8);
+      std::memcpy(&k, pattern + phase, 8);
+      d ^= k;
+      std::memcpy(data + i, &d, 8);
+      phase = (phase + 8) % keyLen;
+    }
+    for (; i < n; ++i) {
+      data[i] ^= pattern[phase];
+      if (++phase == keyLen) phase = 0;
+    }
+    return phase;
+  }
+
+#if defined(CRIPTO_X86)
+  CRIPTO_TARGET("sse2")
+  static size_t xorSSE2(unsigned char* data, size_t n,
+    const unsigned char* pattern, size_t keyLen, size_t& phase)
+  {
+    const size_t step = 16 % keyLen;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+      __m128i d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+      __m128i k = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pattern + phase));
+      _mm_storeu_si128(reinterpret_cast<__m128i*>(data + i), _mm_xor_si128(d, k));
+      phase += step;
+      if (phase >= keyLen) phase -= keyLen;
+    }
+    return i;
+  }
+
+  CRIPTO_TARGET("avx2")
+  static size_t xorAVX2(unsigned char* data, size_t n,
+    const unsigned char* pattern, size_t keyLen, size_t& phase)
+  {
+    const size_t step = 32 % keyLen;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+      __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+      __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pattern + phase));
+      _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + i), _mm256_xor_si256(d, k));
+      phase += step;
+      if (phase >= keyLen) phase -= keyLen;
+    }
+    return i;
+  }
+#endif
+
+  static constexpr size_t kMinShard = 1 << 16;  // bytes mnimos por trozo de la lista
+
+  // --- Filtro de candidatos con rechazo temprano ---
+  static constexpr size_t kFirstStage = 32;        // bytes del primer tramo
+  static constexpr size_t kMaxStage = 1 << 16;     // tope de crecimiento de los tramos
+
+  // Descifra en 'plain' por tramos crecientes (32, 64, 128... bytes) y
+  // valida cada tramo apenas se descifra con la tabla de bytes legibles.
+  // Devuelve false en el primer byte no legible: la mayora de las claves
+  // errneas se descartan tras unas decenas de bytes, sin descifrar el resto.
+  static bool decodeIfReadable(const unsigned char* cipher, size_t n,
+    const unsigned char* pattern, size_t keyLen, unsigned char* plain)
+  {
+    const auto& readable = TextStatistics::readableBytes();
+    size_t pos = 0, stage = kFirstStage, phase = 0;
+    while (pos < n) {
+      size_t len = std::min(stage, n - pos);
+      std::memcpy(plain + pos, cipher + pos, len);
+      phase = xorPattern(plain + pos, len, pattern, keyLen, phase);
+      for (size_t i = pos; i < pos + len; ++i) {
+        if (!readable[plain[i]]) return false;
+      }
+      pos += len;
+      stage = std::min(stage * 2, kMaxStage);
+    }
+    return true;
+  }
+
+  // --- Ataque estadstico: estimacin de longitud y solucin por columna ---
+  static constexpr size_t kStatSample = 1 << 18;     // bytes usados para estimar la longitud
+  static constexpr size_t kHammingPairs = 64;        // pares de bloques por longitud
+  static constexpr size_t kLengthCandidates = 6;     // longitudes que se resuelven por completo
+
+  static std::string breakRepeatingKey(const unsigned char* data, size_t n,
+    size_t maxKeyLen)
+  {
+    if (n < 2 || maxKeyLen == 0) return std::string();
+    const size_t sample = std::min(n, kStatSample);
+    maxKeyLen = std::max<size_t>(1, std::min(maxKeyLen, sample / 2));
+
+    // 1) Puntaje de cada longitud candidata
+    struct LengthScore { size_t len; double ioc; double hamming; };
+    std::vector<LengthScore> lengths;
+    std::array<uint64_t, 256> hist;
+    for (size_t L = 1; L <= maxKeyLen; ++L) {
+      double ioc = 0.0;
+      for (size_t col = 0; col < L; ++col) {
+        hist.fill(0);
+        uint64_t total = 0;
+        for (size_t i = col; i < sample; i += L, ++total) ++hist[data[i]];
+        ioc += TextStatistics::indexOfCoincidence(hist.data(), 256, total);
+      }
+      ioc /= double(L);
+
+      size_t pairs = std::min(sample / L - 1, kHammingPairs);
+      uint64_t bits = 0;
+      for (size_t p = 0; p < pairs; ++p) {
+        const unsigned char* a = data + p * L;
+        for (size_t i = 0; i < L; ++i) bits += popcount8(a[i] ^ a[i + L]);
+      }
+      double hamming = pairs ? double(bits) / double(pairs * L) : 8.0;
+      lengths.push_back({ L, ioc, hamming });
+    }
+
+    // Candidatas: las mejores segn cada medida por separado
+    std::vector<size_t> candidates;
+    auto take = [&](auto better) {
+      std::vector<LengthScore> order = lengths;
+      std::stable_sort(order.begin(), order.end(), better);
+      for (size_t i = 0; i < std::min(kLengthCandidates, order.size()); ++i) {
+        candidates.push_back(order[i].len);
+      }
+    };
+    take([](const LengthScore& a, const LengthScore& b) { return a.ioc > b.ioc; });
+    take([](const LengthScore& a, const LengthScore& b) { return a.hamming < b.hamming; });
+    std::sort(candidates.begin(), candidates.end());
+    candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+    // 2) Resolver cada longitud candidata columna por columna. Se recorre de
+    //    menor a mayor y una longitud mayor solo gana con una mejora clara,
+    //    porque los mltiplos de la longitud real sobreajustan el puntaje.
+    std::string bestKey;
+    double bestScore = -std::numeric_limits<double>::infinity();
+    for (size_t L : candidates) {
+      double score = 0.0;
+      std::string key = solveColumns(data, n, L, score);
+      key = minimalPeriod(key);
+      if (bestKey.empty() || score > bestScore + std::abs(bestScore) * 0.005) {
+        if (key == bestKey) continue;
+        bestKey = key;
+        bestScore = score;
+      }
+    }
+    return bestKey;
+  }
+
+  // Elige cada byte de la clave maximizando la log-verosimilitud de su
+  // columna. Se construye un histograma por columna y se evala cada byte
+  // de clave sobre el histograma, sin volver a recorrer los datos.
+  static std::string solveColumns(const unsigned char* data, size_t n,
+    size_t keyLen, double& totalScore)
+  {
+    const auto& logp = TextStatistics::byteLogProbabilities();
+    std::string key(keyLen, '\0');
+    std::vector<std::array<uint64_t, 256>> hist(keyLen);
+    for (auto& h : hist) h.fill(0);
+    for (size_t i = 0, col = 0; i < n; ++i) {
+      ++hist[col][data[i]];
+      if (++col == keyLen) col = 0;
+    }
+
+    totalScore = 0.0;
+    for (size_t col = 0; col < keyLen; ++col) {
+      double best = -std::numeric_limits<double>::infinity();
+      int bestByte = 0;
+      for (int k = 0; k < 256; ++k) {
+        double score = 0.0;
+        for (int b = 0; b < 256; ++b) {
+          if (hist[col][b]) score += double(hist[col][b]) * logp[b ^ k];
+        }
+        if (score > best) {
+          best = score;
+          bestByte = k;
+        }
+      }
+      key[col] = static_cast<char>(bestByte);
+      totalScore += best;
+    }
+    return key;
+  }
+
+  // Reduce "abcabc" a "abc": la clave ms corta que genera el mismo flujo.
+  static std::string minimalPeriod(const std::string& key) {
+    for (size_t p = 1; p < key.size(); ++p) {
+      if (key.size() % p != 0) continue;
+      bool periodic = true;
+      for (size_t i = p; i < key.size() && periodic; ++i) {
+        periodic = key[i] == key[i - p];
+      }
+      if (periodic) return key.substr(0, p);
+    }
+    return key;
+  }
+
+  static int popcount8(unsigned int x) {
+    x = x - ((x >> 1) & 0x55);
+    x = (x & 0x33) + ((x >> 2) & 0x33);
+    return (x + (x >> 4)) & 0x0F;
+  }
+
+  // Escribe el ranking en el archivo de candidatos; el texto de cada
+  // clave se regenera desde el cifrado solo para los ganadores.
+  static void saveCandidates(CandidateArchive& archive,
+    const std::vector<unsigned char>& cipher,
+    const std::string& path,
+    bool keyOnly)
+  {
+    const uint64_t source = CandidateArchive::fingerprint(cipher.data(), cipher.size());
+    size_t count = archive.commit(path, source, [&](const std::string& key) {
+      std::string plain(cipher.begin(), cipher.end());
+      xorInPlace(reinterpret_cast<unsigned char*>(&plain[0]), plain.size(),
+        reinterpret_cast<const unsigned char*>(key.data()), key.size());
+      return plain;
+      }, keyOnly);
+    for (const auto& e : archive.ranking()) {
+      std::cout << "  key=0x" << CandidateArchive::toHex(e.value)
+        << "  score=" << e.score << "\n";
+    }
+    std::cout << "Guardado: " << path << " (" << count << " candidatos)\n";
+  }
+
   // --- Lectura / escritura binaria ---
+  static std::istream& openInput(const std::string& path, std::ifstream& file) {
+    if (path == "-") {
+      setBinaryMode(stdin);
+      return std::cin;
+    }
+    file.open(path, std::ios::binary);
+    if (!file) throw std::runtime_error("No se pudo abrir: " + path);
+    return file;
+  }
+
+  static std::ostream& openOutput(const std::string& path, std::ofstream& file) {
+    if (path == "-") {
+      setBinaryMode(stdout);
+      return std::cout;
+    }
+    file.open(path, std::ios::binary);
+    if (!file) throw std::runtime_error("No se pudo escribir: " + path);
+    return file;
+  }
+
+  // Nombre libre en el mismo directorio que path, para que el rename final
+  // no cruce sistemas de archivos.
+  static std::string tempPathFor(const std::string& path) {
+    std::random_device rd;
+    for (int attempt = 0; attempt < 16; ++attempt) {
+      std::ostringstream name;
+      name << path << ".tmp" << std::hex << rd() << rd();
+      if (!fs::exists(name.str())) return name.str();
+    }
+    throw std::runtime_error("No se pudo crear un temporal para: " + path);
+  }
+
+  // En Windows stdin/stdout abren en modo texto y traduciran los \r\n.
+  static void setBinaryMode(FILE* stream) {
+#if defined(_WIN32)
+    _setmode(_fileno(stream), _O_BINARY);
+#else
+    (void)stream;
+#endif
+  }
+
   static std::vector<unsigned char> readFile(const std::string& path) {
     std::ifstream in(path, std::ios::binary);
     if (!in) throw std::runtime_error("No se pudo abrir: " + path);
@@ -135,8 +717,12 @@ private:
 
   // --- Valida texto legible ASCII ---
   bool isValidText(const std::string& data) const {
-    return std::all_of(data.begin(), data.end(), [](unsigned char c) {
-      return std::isprint(c) || std::isspace(c) || c == '\n' || c == '\r';
-      });
+    return isValidText(reinterpret_cast<const unsigned char*>(data.data()),
+      data.size());
+  }
+
+  static bool isValidText(const unsigned char* data, size_t n) {
+    const auto& readable = TextStatistics::readableBytes();
+    return std::all_of(data, data + n, [&](unsigned char c) { return readable[c]; });
   }
 };
\ No newline at end of file